@@ -0,0 +1,349 @@
+#include <charconv>
+#include <cstddef>
+#include <memory>
+#include <sstream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <yaml/editable.hpp>
+#include <yaml/parallel.hpp>
+#include <yaml/parser.hpp>
+#include <yaml/stream.hpp>
+#include <yaml/yaml.hpp>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "measure.hpp"
+
+// the previous tree layout: one shared_ptr allocation per node and heap vectors for collections
+namespace shared {
+
+struct node
+{
+  virtual ~node() = default;
+};
+
+using node_ref = std::shared_ptr<node>;
+
+struct failsafe_node : node
+{
+  using node_data =
+    std::variant<std::string_view, std::vector<node_ref>, std::vector<std::pair<node_ref, node_ref>>>;
+  failsafe_node(node_data &&_data) : data(std::move(_data)) {}
+  node_data data;
+};
+
+}// namespace shared
+
+namespace {
+
+constexpr auto entries = std::size_t{ 20'000 };// 5 nodes per entry, 100k nodes per tree
+
+shared::node_ref build_shared()
+{
+  auto items = std::vector<shared::node_ref>{};
+  items.reserve(entries);
+  for (auto i = std::size_t{ 0 }; i < entries; ++i) {
+    auto pairs = std::vector<std::pair<shared::node_ref, shared::node_ref>>{};
+    pairs.emplace_back(std::make_shared<shared::failsafe_node>(std::string_view{ "name" }),
+      std::make_shared<shared::failsafe_node>(std::string_view{ "value" }));
+    pairs.emplace_back(std::make_shared<shared::failsafe_node>(std::string_view{ "id" }),
+      std::make_shared<shared::failsafe_node>(std::string_view{ "42" }));
+    items.push_back(std::make_shared<shared::failsafe_node>(std::move(pairs)));
+  }
+  return std::make_shared<shared::failsafe_node>(std::move(items));
+}
+
+yaml::document<yaml::failsafe::node> build_arena()
+{
+  using yaml::failsafe;
+  auto result = yaml::document<failsafe::node>{};
+  auto items = std::vector<failsafe::node_ref>{};
+  items.reserve(entries);
+  for (auto i = std::size_t{ 0 }; i < entries; ++i) {
+    std::pair<failsafe::node_ref, failsafe::node_ref> pairs[] = {
+      { result.create(failsafe::scalar{ "name" }), result.create(failsafe::scalar{ "value" }) },
+      { result.create(failsafe::scalar{ "id" }), result.create(failsafe::scalar{ "42" }) },
+    };
+    auto *data = static_cast<std::pair<failsafe::node_ref, failsafe::node_ref> *>(
+      result.resource().allocate(sizeof(pairs), alignof(std::pair<failsafe::node_ref, failsafe::node_ref>)));
+    std::uninitialized_copy(std::begin(pairs), std::end(pairs), data);
+    items.push_back(result.create(failsafe::mapping{ data, std::size(pairs) }));
+  }
+  result.set_root(result.create(failsafe::sequence{ result.copy(std::span<const failsafe::node_ref>{ items }) }));
+  return result;
+}
+
+std::string generate_entries()
+{
+  auto content = std::string{};
+  for (auto i = std::size_t{ 0 }; i < entries; ++i) content += "- name: value\n  id: 42\n";
+  return content;
+}
+
+}// namespace
+
+TEST_CASE("Tree layout", "[benchmark]")
+{
+  BENCHMARK("shared_ptr tree: build 100k nodes") { return build_shared(); };
+  BENCHMARK("arena document: build 100k nodes") { return build_arena(); };
+
+  // releasing an arena does not depend on the node count, compare with the build only figures above
+  BENCHMARK("shared_ptr tree: build and release 100k nodes") { build_shared(); };
+  BENCHMARK("arena document: build and release 100k nodes") { build_arena(); };
+
+  auto content = generate_entries();
+  BENCHMARK("arena document: load 100k nodes") { return yaml::load(content); };
+}
+
+TEST_CASE("On demand lookups", "[benchmark]")
+{
+  // 50k lines, the keys read sit at the end of the document
+  auto content = std::string{};
+  for (auto i = std::size_t{ 0 }; i < entries; ++i)
+    content += "key" + std::to_string(i) + ":\n  name: value\n  id: 42\n";
+  content += "last:\n  name: found\n";
+
+  BENCHMARK("arena document: load the whole document") { return yaml::load(content); };
+  BENCHMARK("on demand: read 1 key")
+  {
+    return yaml::load<yaml::ondemand>(content)["last"]["name"].scalar();
+  };
+}
+
+TEST_CASE("Key lookups", "[benchmark]")
+{
+  auto content = std::string{};
+  for (auto i = std::size_t{ 0 }; i < entries; ++i) content += "flag" + std::to_string(i) + ": on\n";
+  auto loaded = yaml::load(content);
+  auto mapping = loaded->as<yaml::failsafe::mapping>();
+  auto key = "flag" + std::to_string(entries / 2);
+
+  BENCHMARK("linear scan: 1 lookup in 20k keys")
+  {
+    for (auto &[k, v] : mapping)
+      if (k->as<yaml::failsafe::scalar>() == key) return v;
+    return yaml::failsafe::node_ref{};
+  };
+  BENCHMARK("key index: build over 20k keys") { return yaml::key_index{ mapping }; };
+  auto index = yaml::key_index{ mapping };
+  BENCHMARK("key index: 1 lookup in 20k keys") { return index.find(key); };
+}
+
+namespace {
+
+struct entry
+{
+  std::string name;
+  int id = 0;
+
+  static constexpr auto yaml_fields()
+  {
+    return std::tuple{ yaml::field{ "name", &entry::name }, yaml::field{ "id", &entry::id } };
+  }
+};
+
+}// namespace
+
+TEST_CASE("Struct binding", "[benchmark]")
+{
+  auto content = generate_entries();
+  BENCHMARK("arena document: load 100k nodes then fill 20k structs")
+  {
+    auto loaded = yaml::load(content);
+    auto result = std::vector<entry>{};
+    for (auto *item : loaded->as<yaml::failsafe::sequence>()) {
+      auto &value = result.emplace_back();
+      for (auto &[key, field] : item->as<yaml::failsafe::mapping>()) {
+        auto text = field->as<yaml::failsafe::scalar>();
+        if (key->as<yaml::failsafe::scalar>() == "name")
+          value.name = text;
+        else if (key->as<yaml::failsafe::scalar>() == "id")
+          std::from_chars(text.data(), text.data() + text.size(), value.id);
+      }
+    }
+    return result;
+  };
+  BENCHMARK("load_into: fill 20k structs") { return yaml::load_into<std::vector<entry>>(content); };
+}
+
+TEST_CASE("Emitting", "[benchmark]")
+{
+  auto content = generate_entries();
+  auto loaded = yaml::load(content);
+  BENCHMARK("emitter: dump 100k nodes") { return yaml::dump(*loaded); };
+  BENCHMARK("emitter: dump 100k nodes in flow style") { return yaml::dump(*loaded, { .flow = true }); };
+}
+
+TEST_CASE("Parallel stream loading", "[benchmark]")
+{
+  // 20k log entries of 5 lines each
+  auto content = std::string{};
+  for (auto i = std::size_t{ 0 }; i < entries; ++i)
+    content += "---\nTime: 2001-11-23 15:01:42 -5\nUser: ed\nWarning:\n  entry " + std::to_string(i) + "\n";
+
+  BENCHMARK("load_all_parallel: 20k documents on 1 thread") { return yaml::load_all_parallel(content, 1); };
+  BENCHMARK("load_all_parallel: 20k documents on every core") { return yaml::load_all_parallel(content); };
+}
+
+TEST_CASE("Parallel document splitting", "[benchmark]")
+{
+  // a single mapping of 20k entries of 4 lines each
+  auto content = std::string{};
+  for (auto i = std::size_t{ 0 }; i < entries; ++i)
+    content += "entry" + std::to_string(i) + ":\n  user: ed\n  time: 2001-11-23 15:01:42 -5\n  tags: [a, b]\n";
+
+  BENCHMARK("load: 20k entries") { return yaml::load(content); };
+  BENCHMARK("load_parallel: 20k entries on every core") { return yaml::load_parallel(content); };
+}
+
+TEST_CASE("Incremental editing", "[benchmark]")
+{
+  // 50k lines, one value edited back and forth
+  auto content = std::string{};
+  for (auto i = std::size_t{ 0 }; i < 25000; ++i)
+    content += "entry" + std::to_string(i) + ":\n  name: n" + std::to_string(i) + "\n";
+  auto edited = yaml::editable_document{ content };
+  auto offset = content.find("n12500") + 1;
+  auto flip = false;
+
+  BENCHMARK("load: 50k lines") { return yaml::load(content); };
+  BENCHMARK("editable_document: one line edited in 50k lines")
+  {
+    edited.apply({ offset, 1, (flip = !flip) ? "x" : "1" });
+    return edited.size();
+  };
+}
+
+TEST_CASE("Load statistics", "[benchmark]")
+{
+  auto content = generate_entries();
+  auto schema = yaml::instrumented<yaml::failsafe>{};
+  auto events = std::size_t{ 0 };
+  schema.on_load = [&](const yaml::load_stats &_stats) { events += _stats.events; };
+
+  // failsafe composes the same way as before the stats, instrumented reads the clock at each change of phase
+  BENCHMARK("load: 100k nodes") { return yaml::load(content); };
+  BENCHMARK("instrumented load: 100k nodes") { return schema.load(content); };
+}
+
+TEST_CASE("Encodings", "[benchmark]")
+{
+  auto content = generate_entries();
+  // the same content in utf-16 le with a byte order mark
+  auto utf16 = std::string{ "\xFF\xFE" };
+  for (auto c : content) {
+    utf16 += c;
+    utf16 += '\0';
+  }
+
+  BENCHMARK("is_utf8: 100k nodes") { return yaml::is_utf8(content); };
+  BENCHMARK("to_utf8: 100k nodes from utf-16") { return yaml::to_utf8(utf16); };
+  BENCHMARK("load: 100k nodes") { return yaml::load(content); };
+  BENCHMARK("load: 100k nodes from utf-16") { return yaml::load(utf16); };
+}
+
+TEST_CASE("Decoding scalars", "[benchmark]")
+{
+  // 20k escaped strings, multi-line quoted strings and folded blocks, as found in certificates and secrets
+  auto escaped = std::string{};
+  auto quoted = std::string{};
+  auto folded = std::string{};
+  for (auto i = std::size_t{ 0 }; i < entries; ++i) {
+    auto id = std::to_string(i);
+    escaped += "key" + id
+               + ": \"-----BEGIN CERTIFICATE-----\\nMIIDdzCCAl+gAwIBAgIEAgAAuTANBgkqhkiG9w0BAQUFADBaMQswCQYDVQQGEwJJ\\n"
+                 "RTESMBAGA1UEChMJQmFsdGltb3JlMRMwEQYDVQQLEwpDeWJlclRydXN0\\u00e9\\x41\\t-----END CERTIFICATE-----\\n\"\n";
+    quoted += "key" + id
+              + ": \"a long description of the entry\n  spanning several lines of text with words\n\n  and an empty "
+                "line between its paragraphs\"\n";
+    folded += "key" + id
+              + ": >\n  a long description of the entry\n  spanning several lines of text with words\n\n  and an empty "
+                "line between its paragraphs\n";
+  }
+
+  BENCHMARK("load: 20k escaped strings") { return yaml::load(escaped); };
+  BENCHMARK("load: 20k multi-line strings") { return yaml::load(quoted); };
+  BENCHMARK("load: 20k folded blocks") { return yaml::load(folded); };
+}
+
+TEST_CASE("Reusable parser", "[benchmark]")
+{
+  // a small request as received by an rpc gateway, loaded 1k times between resets
+  auto payload = std::string{ "id: &request 1234\nmethod: \"users.get\"\nparams:\n  user: 'it''s me'\n  fields: [name, "
+                              "email, roles]\n  limit: !!int 20\ntrace: *request\n" };
+  auto parser = yaml::parser{};
+  auto load_all = [&](std::string_view _payload) {
+    parser.reset();
+    auto loaded = std::size_t{ 0 };
+    for (auto i = 0; i < 1000; ++i) loaded += parser.load(_payload).as<yaml::failsafe::mapping>().size();
+    return loaded;
+  };
+
+  // once warmed up, loading allocates nothing, utf-16 payloads are transcoded into the recycled pool
+  auto utf16 = std::string{};
+  for (auto c : payload) utf16.append({ c, '\0' });
+  for (auto content : { std::string_view{ payload }, std::string_view{ utf16 } }) {
+    load_all(content);
+    auto before = measure::allocated();
+    load_all(content);
+    auto after = measure::allocated();
+    CHECK(after.count == before.count);
+  }
+
+  BENCHMARK("load: 1k small payloads") {
+    auto loaded = std::size_t{ 0 };
+    for (auto i = 0; i < 1000; ++i) loaded += yaml::load(payload)->as<yaml::failsafe::mapping>().size();
+    return loaded;
+  };
+  BENCHMARK("parser: 1k small payloads") { return load_all(payload); };
+  BENCHMARK("parser: 1k small utf-16 payloads") { return load_all(utf16); };
+}
+
+TEST_CASE("Feeding chunks", "[benchmark]")
+{
+  // 20k log entries of 5 lines each, received in packets of 1460 bytes
+  auto content = std::string{};
+  for (auto i = std::size_t{ 0 }; i < entries; ++i)
+    content += "---\nTime: 2001-11-23 15:01:42 -5\nUser: ed\nWarning:\n  entry " + std::to_string(i) + "\n";
+  auto text = std::string_view{ content };
+
+  BENCHMARK("stream: 20k documents") {
+    auto input = std::istringstream{ content };
+    auto loaded = std::size_t{ 0 };
+    for (auto &document : yaml::stream{ input }) loaded += document->as<yaml::failsafe::mapping>().size();
+    return loaded;
+  };
+  BENCHMARK("feed_parser: 20k documents in 1460 byte chunks") {
+    auto loaded = std::size_t{ 0 };
+    auto parser = yaml::feed_parser{ [&](yaml::document<yaml::failsafe::node> _document) {
+      loaded += _document->as<yaml::failsafe::mapping>().size();
+    } };
+    for (auto at = std::size_t{ 0 }; at < text.size(); at += 1460) parser.feed(text.substr(at, 1460));
+    parser.finish();
+    return loaded;
+  };
+
+  // the same entries as the items of a single document, parsed as they are received
+  auto sequence = std::string{};
+  for (auto i = std::size_t{ 0 }; i < entries; ++i)
+    sequence += "- Time: 2001-11-23 15:01:42 -5\n  User: ed\n  Warning:\n    entry " + std::to_string(i) + "\n";
+  auto items = std::string_view{ sequence };
+  BENCHMARK("parse: events of a single document") {
+    auto count = std::size_t{ 0 };
+    yaml::parse(items, [&](const yaml::event &) { ++count; });
+    return count;
+  };
+  BENCHMARK("feed_parser: events of a single document in 1460 byte chunks") {
+    auto count = std::size_t{ 0 };
+    auto parser = yaml::feed_parser{ [&](const yaml::event &) { ++count; } };
+    for (auto at = std::size_t{ 0 }; at < items.size(); at += 1460) parser.feed(items.substr(at, 1460));
+    parser.finish();
+    return count;
+  };
+}
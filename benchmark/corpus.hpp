@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+// generated inputs of about _size bytes, each stressing one part of the parser
+namespace corpus {
+
+// block mappings nested 64 levels deep
+inline std::string deep_nesting(std::size_t _size)
+{
+  constexpr auto depth = std::size_t{ 64 };
+  auto result = std::string{};
+  for (auto entry = std::size_t{ 0 }; result.size() < _size; ++entry) {
+    result += "- ";
+    for (auto level = std::size_t{ 0 }; level < depth; ++level) {
+      if (level) result.append(2 * level + 2, ' ');
+      result += "level" + std::to_string(level) + ":\n";
+    }
+    result.append(2 * depth + 2, ' ');
+    result += "leaf: " + std::to_string(entry) + "\n";
+  }
+  return result;
+}
+
+// a single mapping with one short key and value per line
+inline std::string wide_mapping(std::size_t _size)
+{
+  auto result = std::string{};
+  for (auto entry = std::size_t{ 0 }; result.size() < _size; ++entry)
+    result += "key" + std::to_string(entry) + ": value " + std::to_string(entry) + "\n";
+  return result;
+}
+
+// literal and folded scalars of 64 lines of 80 columns
+inline std::string block_scalars(std::size_t _size)
+{
+  auto line = std::string(76, 'x');
+  auto result = std::string{};
+  for (auto entry = std::size_t{ 0 }; result.size() < _size; ++entry) {
+    result += "text" + std::to_string(entry) + (entry % 2 ? ": >\n" : ": |\n");
+    for (auto i = 0; i < 64; ++i) result += "    " + line + "\n";
+  }
+  return result;
+}
+
+// a json array of objects
+inline std::string flow_json(std::size_t _size)
+{
+  auto result = std::string{ "[\n" };
+  for (auto entry = std::size_t{ 0 }; result.size() < _size; ++entry) {
+    auto id = std::to_string(entry);
+    if (entry) result += ",\n";
+    result += R"(  {"id": )" + id + R"(, "name": "item é )" + id
+              + R"(", "tags": ["a", "b", "c"], "position": {"x": 1.5, "y": -2e3, "visible": true}, "parent": null})";
+  }
+  result += "\n]\n";
+  return result;
+}
+
+// anchored mappings each referred to by several aliases
+inline std::string aliases(std::size_t _size)
+{
+  auto result = std::string{};
+  for (auto entry = std::size_t{ 0 }; result.size() < _size; ++entry) {
+    auto anchor = "a" + std::to_string(entry % 4096);
+    result += "- &" + anchor + " {name: n" + std::to_string(entry) + ", id: " + std::to_string(entry) + "}\n";
+    for (auto i = 0; i < 4; ++i) result += "- *" + anchor + "\n";
+  }
+  return result;
+}
+
+// documents of a stream produced on the fly so that streams larger than the memory can be read, the last document is
+// completed past _size
+class stream_source
+{
+public:
+  explicit stream_source(std::size_t _size) : size(_size) {}
+
+  std::size_t read(std::span<char> _chunk)
+  {
+    auto written = std::size_t{ 0 };
+    while (written < _chunk.size()) {
+      if (at == pending.size()) {
+        if (produced >= size) break;
+        pending = "--- # document " + std::to_string(documents++)
+                  + "\nTime: 2001-11-23 15:01:42 -5\nUser: ed\nWarning:\n  This is an error message for the log file\n";
+        at = 0;
+      }
+      auto count = std::min(_chunk.size() - written, pending.size() - at);
+      std::copy_n(pending.data() + at, count, _chunk.data() + written);
+      written += count;
+      at += count;
+      produced += count;
+    }
+    return written;
+  }
+
+private:
+  std::size_t size;
+  std::size_t produced = 0;
+  std::size_t documents = 0;
+  std::string pending;
+  std::size_t at = 0;
+};
+
+}// namespace corpus
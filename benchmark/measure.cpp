@@ -0,0 +1,82 @@
+#include "measure.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+
+#include <psapi.h>
+#elif !defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+std::atomic<std::size_t> allocation_count{ 0 };
+std::atomic<std::size_t> allocation_bytes{ 0 };
+
+void *allocate(std::size_t _size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocation_bytes.fetch_add(_size, std::memory_order_relaxed);
+  if (auto *result = std::malloc(_size ? _size : 1)) return result;
+  throw std::bad_alloc{};
+}
+
+}// namespace
+
+// the aligned forms are left to the standard library, the library and its arenas do not use over-aligned types
+void *operator new(std::size_t _size) { return allocate(_size); }
+void *operator new[](std::size_t _size) { return allocate(_size); }
+void operator delete(void *_pointer) noexcept { std::free(_pointer); }
+void operator delete[](void *_pointer) noexcept { std::free(_pointer); }
+void operator delete(void *_pointer, std::size_t) noexcept { std::free(_pointer); }
+void operator delete[](void *_pointer, std::size_t) noexcept { std::free(_pointer); }
+
+namespace measure {
+
+allocations allocated() noexcept
+{
+  return { allocation_count.load(std::memory_order_relaxed), allocation_bytes.load(std::memory_order_relaxed) };
+}
+
+#if defined(__linux__)
+std::size_t peak_rss()
+{
+  auto status = std::ifstream{ "/proc/self/status" };
+  for (auto line = std::string{}; std::getline(status, line);)
+    if (line.starts_with("VmHWM:")) return std::stoull(line.substr(6)) * 1024;
+  return 0;
+}
+
+void reset_peak_rss() { std::ofstream{ "/proc/self/clear_refs" } << "5"; }
+#elif defined(_WIN32)
+std::size_t peak_rss()
+{
+  auto counters = PROCESS_MEMORY_COUNTERS{};
+  if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+  return counters.PeakWorkingSetSize;
+}
+
+void reset_peak_rss() {}
+#else
+std::size_t peak_rss()
+{
+  auto usage = rusage{};
+  if (getrusage(RUSAGE_SELF, &usage)) return 0;
+#if defined(__APPLE__)
+  return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+  return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+void reset_peak_rss() {}
+#endif
+
+}// namespace measure
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+// process wide figures taken around the benchmarked operations
+namespace measure {
+
+struct allocations
+{
+  std::size_t count = 0;
+  std::size_t bytes = 0;
+};
+
+// allocations made through the global operator new since the program started
+allocations allocated() noexcept;
+
+// peak resident set size in bytes since the last reset, 0 when the system does not report it
+std::size_t peak_rss();
+
+// restarts the peak resident set size from the current one where the system allows it, otherwise the peak keeps
+// covering the whole run
+void reset_peak_rss();
+
+}// namespace measure
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <yaml/stream.hpp>
+#include <yaml/yaml.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "corpus.hpp"
+#include "measure.hpp"
+
+// load, traversal and dump throughput over the generated corpora. every operation runs until it took a second, at
+// most 10 times, and the fastest run is reported. the corpora hold YAML_BENCHMARK_MB megabytes each, 16 by default,
+// the stream is YAML_BENCHMARK_STREAM_MB megabytes, 64 by default, and is generated while it is read so multi
+// gigabyte streams only need the memory of one document.
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+std::size_t megabytes(const char *_variable, std::size_t _default)
+{
+  auto *value = std::getenv(_variable);
+  return (value ? std::strtoull(value, nullptr, 10) : _default) * 1024 * 1024;
+}
+
+struct figures
+{
+  double seconds = 0;// fastest run
+  measure::allocations allocations;// of the first run
+  std::size_t peak_rss = 0;
+};
+
+template<typename Operation> figures run(Operation &&_operation)
+{
+  auto result = figures{};
+  measure::reset_peak_rss();
+  auto total = clock::duration{};
+  for (auto runs = 0; runs < 10 && total < std::chrono::seconds{ 1 }; ++runs) {
+    auto before = measure::allocated();
+    auto start = clock::now();
+    _operation();
+    auto elapsed = clock::now() - start;
+    if (runs == 0) {
+      auto after = measure::allocated();
+      result.allocations = { after.count - before.count, after.bytes - before.bytes };
+      result.seconds = std::chrono::duration<double>(elapsed).count();
+    }
+    result.seconds = std::min(result.seconds, std::chrono::duration<double>(elapsed).count());
+    total += elapsed;
+  }
+  result.peak_rss = measure::peak_rss();
+  return result;
+}
+
+void header()
+{
+  std::cout << std::left << std::setw(16) << "corpus" << std::setw(10) << "operation" << std::right << std::setw(10)
+            << "MB" << std::setw(10) << "MB/s" << std::setw(12) << "Mnodes/s" << std::setw(14) << "allocations"
+            << std::setw(14) << "allocated MB" << std::setw(14) << "peak RSS MB" << "\n";
+}
+
+void report(std::string_view _corpus, std::string_view _operation, std::size_t _bytes, std::size_t _nodes,
+  const figures &_figures)
+{
+  constexpr auto mb = 1024.0 * 1024.0;
+  std::cout << std::left << std::setw(16) << _corpus << std::setw(10) << _operation << std::right << std::fixed
+            << std::setprecision(1) << std::setw(10) << static_cast<double>(_bytes) / mb << std::setw(10)
+            << static_cast<double>(_bytes) / mb / _figures.seconds << std::setw(12) << std::setprecision(2)
+            << static_cast<double>(_nodes) / 1e6 / _figures.seconds << std::setw(14) << _figures.allocations.count
+            << std::setw(14) << std::setprecision(1) << static_cast<double>(_figures.allocations.bytes) / mb
+            << std::setw(14) << static_cast<double>(_figures.peak_rss) / mb << std::endl;
+}
+
+// nodes visited by a full traversal, aliased nodes are visited at every alias
+std::size_t count_nodes(const yaml::failsafe::node &_root)
+{
+  auto result = std::size_t{ 0 };
+  auto pending = std::vector<const yaml::failsafe::node *>{ &_root };
+  while (!pending.empty()) {
+    auto *current = pending.back();
+    pending.pop_back();
+    ++result;
+    if (auto *items = current->try_as<yaml::failsafe::sequence>())
+      for (auto *item : *items) pending.push_back(item);
+    else if (auto *entries = current->try_as<yaml::failsafe::mapping>())
+      for (auto &[key, value] : *entries) {
+        pending.push_back(key);
+        pending.push_back(value);
+      }
+  }
+  return result;
+}
+
+}// namespace
+
+TEST_CASE("Throughput", "[throughput]")
+{
+  struct generated
+  {
+    std::string_view name;
+    std::string (*generate)(std::size_t);
+  };
+  auto size = megabytes("YAML_BENCHMARK_MB", 16);
+  // the alias corpus expands beyond the default limit, which guards untrusted inputs
+  auto schema = yaml::failsafe{ .max_alias_expansion = std::numeric_limits<std::size_t>::max() };
+
+  header();
+  for (auto corpus : { generated{ "deep nesting", corpus::deep_nesting },
+         generated{ "wide mapping", corpus::wide_mapping }, generated{ "block scalars", corpus::block_scalars },
+         generated{ "flow json", corpus::flow_json }, generated{ "aliases", corpus::aliases } }) {
+    auto content = corpus.generate(size);
+    auto loaded = schema.load(content);
+    auto nodes = count_nodes(*loaded);
+    REQUIRE(nodes > 1);
+
+    auto events = std::size_t{ 0 };
+    report(corpus.name, "parse", content.size(), nodes,
+      run([&] { yaml::parse(content, [&](const yaml::event &) { ++events; }); }));
+    CHECK(events > nodes / 2);
+    report(corpus.name, "load", content.size(), nodes, run([&] { loaded = schema.load(content); }));
+    auto visited = std::size_t{ 0 };
+    report(corpus.name, "traverse", content.size(), nodes, run([&] { visited = count_nodes(*loaded); }));
+    CHECK(visited == nodes);
+    auto written = std::string{};
+    auto dumped = run([&] { written = yaml::dump(*loaded); });
+    report(corpus.name, "dump", written.size(), nodes, dumped);
+  }
+
+  // documents are read one at a time, the memory stays the one of a document whatever the size of the stream
+  auto stream_size = megabytes("YAML_BENCHMARK_STREAM_MB", 64);
+  auto read = std::size_t{ 0 };
+  auto nodes = std::size_t{ 0 };
+  auto streamed = run([&] {
+    auto source = corpus::stream_source{ stream_size };
+    read = nodes = 0;
+    auto documents = yaml::stream{ [&](std::span<char> _chunk) {
+      auto count = source.read(_chunk);
+      read += count;
+      return count;
+    } };
+    for (auto &document : documents) nodes += count_nodes(*document);
+  });
+  report("stream", "load", read, nodes, streamed);
+  CHECK(read >= stream_size);
+}
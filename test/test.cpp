@@ -1,16 +1,86 @@
-#include <format>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <new>
+#include <optional>
 #include <print>
+#include <span>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <tuple>
 #include <type_traits>
 #include <variant>
+#include <vector>
+#include <yaml/editable.hpp>
+#include <yaml/parallel.hpp>
+#include <yaml/parser.hpp>
+#include <yaml/stream.hpp>
 #include <yaml/yaml.hpp>
 
 #include <catch2/catch_test_macros.hpp>
 
-template<class... Ts> struct overload : Ts...
+namespace {
+
+const yaml::failsafe::node &get(yaml::failsafe::node_ref _node) { return *_node; }
+
+yaml::failsafe::node_ref at_ref(const yaml::failsafe::node &_mapping, std::string_view _key)
 {
-  using Ts::operator()...;
-};
+  for (auto &[key, value] : _mapping.as<yaml::failsafe::mapping>())
+    if (auto *scalar = get(key).try_as<yaml::failsafe::scalar>(); scalar && *scalar == _key) return value;
+  throw std::out_of_range{ std::string{ _key } };
+}
+
+const yaml::failsafe::node &at(const yaml::failsafe::node &_mapping, std::string_view _key)
+{
+  return get(at_ref(_mapping, _key));
+}
+
+const yaml::failsafe::node &at(const yaml::failsafe::node &_sequence, std::size_t _index)
+{
+  auto entries = _sequence.as<yaml::failsafe::sequence>();
+  if (_index >= entries.size()) throw std::out_of_range{ std::to_string(_index) };
+  return get(entries[_index]);
+}
+
+std::string_view str(const yaml::failsafe::node &_node) { return _node.as<yaml::failsafe::scalar>(); }
+
+std::string fixture(std::string_view _name)
+{
+  auto file = std::ifstream{ std::filesystem::path{ YAML_TEST_FILES } / _name, std::ios::binary };
+  return { std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+}
+
+// utf-16 or utf-32 code units of _width bytes encoding the code points of the utf-8 text
+std::string encode(std::string_view _text, std::size_t _width, bool _big_endian)
+{
+  auto result = std::string{};
+  auto put = [&](char32_t _unit) {
+    for (auto i = std::size_t{ 0 }; i < _width; ++i)
+      result += static_cast<char>(_unit >> (8 * (_big_endian ? _width - 1 - i : i)));
+  };
+  for (auto at = std::size_t{ 0 }; at < _text.size();) {
+    auto lead = static_cast<unsigned char>(_text[at]);
+    auto length = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+    auto code = static_cast<char32_t>(length == 1 ? lead : lead & (0x7F >> length));
+    for (auto i = 1; i < length; ++i) code = (code << 6) | (static_cast<unsigned char>(_text[at + i]) & 0x3Fu);
+    at += static_cast<std::size_t>(length);
+    if (_width == 2 && code >= 0x10000) {
+      put(0xD800 + ((code - 0x10000) >> 10));
+      put(0xDC00 + ((code - 0x10000) & 0x3FF));
+    } else
+      put(code);
+  }
+  return result;
+}
+
+}// namespace
 
 TEST_CASE("Invoice")
 {
@@ -48,33 +118,1274 @@ TEST_CASE("Invoice")
 
   std::println("{}", doc);
 
+  auto loaded = yaml::load(doc);
+  auto &invoice = *loaded;
+  CHECK(str(at(invoice, "invoice")) == "34843");
+  CHECK(str(at(invoice, "date")) == "2001-01-23");
+  CHECK(str(at(at(invoice, "bill-to"), "given")) == "Chris");
+  CHECK(str(at(at(at(invoice, "bill-to"), "address"), "lines")) == "458 Walkman Dr.\nSuite #292\n");
+  CHECK(str(at(at(at(invoice, "bill-to"), "address"), "city")) == "Royal Oak");
+  CHECK(at_ref(invoice, "ship-to") == at_ref(invoice, "bill-to"));
+  CHECK(invoice.as<yaml::failsafe::mapping>().size() == 8);
+  CHECK(at(invoice, "product").as<yaml::failsafe::sequence>().size() == 2);
+  CHECK(str(at(at(at(invoice, "product"), 1), "description")) == "Super Hoop");
+  CHECK(str(at(invoice, "comments")) == "Late afternoon is best. Backup contact is Nancy Billsmer @ 338-4338.");
+
   auto res = yaml::load("[1, 2, 3]");
 
-  std::println("{}",
-    std::visit(overload{ [](const yaml::failsafe::scalar &_val) { return std::format("{}", _val); },
-                 [](this auto const &self, const yaml::failsafe::sequence &_seq) {
-                   auto content = std::string{};
-                   for (auto &element : _seq) {
-                     auto value = std::visit(self, std::static_pointer_cast<yaml::failsafe::node>(element)->data);
-                     if (content.empty())
-                       content += value;
-                     else
-                       content += std::format(", {}", value);
-                   }
-                   return std::format("[ {} ]", content);
-                 },
-                 [](this auto const &self, const yaml::failsafe::mapping &_map) {
-                   auto content = std::string{};
-                   for (auto &[k, v] : _map) {
-                     auto key = std::visit(self, std::static_pointer_cast<yaml::failsafe::node>(k)->data);
-                     auto value = std::visit(self, std::static_pointer_cast<yaml::failsafe::node>(v)->data);
-                     auto formatted = std::format("{} : {}", key, value);
-                     if (content.empty())
-                       content += formatted;
-                     else
-                       content += std::format(", {}", formatted);
-                   }
-                   return std::format("{{ {} }}", content);
-                 } },
-      res.data));
-}
\ No newline at end of file
+  CHECK(yaml::dump(*res, { .flow = true }) == "[1, 2, 3]\n");
+}
+
+TEST_CASE("Scalars are views of the input")
+{
+  auto content = std::string_view{ "plain: some words\nsingle: 'quoted text'\ndouble: \"quoted text\"\n" };
+  auto document = yaml::load(content);
+  auto &root = *document;
+  auto inside = [&](std::string_view _value) {
+    return _value.data() >= content.data() && _value.data() + _value.size() <= content.data() + content.size();
+  };
+
+  CHECK(str(at(root, "plain")) == "some words");
+  CHECK(str(at(root, "single")) == "quoted text");
+  CHECK(str(at(root, "double")) == "quoted text");
+  for (auto &[key, value] : root.as<yaml::failsafe::mapping>()) {
+    CHECK(inside(str(get(key))));
+    CHECK(inside(str(get(value))));
+  }
+}
+
+TEST_CASE("Flow collections")
+{
+  auto document = yaml::load("{ one: [a, b, [c]], \"two\":x, three: , [four]: { five: six }, seven: [eight: nine] }");
+  auto &root = *document;
+  CHECK(str(at(at(root, "one"), 1)) == "b");
+  CHECK(str(at(at(at(root, "one"), 2), 0)) == "c");
+  CHECK(str(at(root, "two")) == "x");
+  CHECK(str(at(root, "three")).empty());
+  CHECK(str(at(at(at(root, "seven"), 0), "eight")) == "nine");
+
+  auto &[key, value] = root.as<yaml::failsafe::mapping>()[3];
+  CHECK(str(at(get(key), 0)) == "four");
+  CHECK(str(at(get(value), "five")) == "six");
+
+  auto multiline = yaml::load("key: [ one,\n  two ,\n\n  three ]\n");
+  CHECK(at(*multiline, "key").as<yaml::failsafe::sequence>().size() == 3);
+}
+
+TEST_CASE("Block collections")
+{
+  auto document = yaml::load(
+    "- a\n"
+    "- - b\n"
+    "  - c\n"
+    "- d: e\n"
+    "  f:\n"
+    "  - g\n"
+    "-\n"
+    "- ? h\n"
+    "  : i\n");
+  auto &root = *document;
+  CHECK(str(at(root, 0)) == "a");
+  CHECK(str(at(at(root, 1), 1)) == "c");
+  CHECK(str(at(at(root, 2), "d")) == "e");
+  CHECK(str(at(at(at(root, 2), "f"), 0)) == "g");
+  CHECK(str(at(root, 3)).empty());
+  CHECK(str(at(at(root, 4), "h")) == "i");
+}
+
+TEST_CASE("Quoted scalars")
+{
+  auto document = yaml::load(
+    "single: 'it''s'\n"
+    "escapes: \"tab\\there \\x41\\u00e9\\U0001F600 \\\"quote\\\"\"\n"
+    "folded: \"one\n  two\n\n  three\"\n"
+    "escaped break: \"one \\\n  two\"\n");
+  auto &root = *document;
+  CHECK(str(at(root, "single")) == "it's");
+  CHECK(str(at(root, "escapes")) == "tab\there A\u00e9\U0001F600 \"quote\"");
+  CHECK(str(at(root, "folded")) == "one two\nthree");
+  CHECK(str(at(root, "escaped break")) == "one two");
+
+  // trailing white spaces are trimmed before a folded line break, escaped ones are kept
+  auto spaces = yaml::load("a: \"one  \t\n  two \\t \n\n  three\\ \"\nb: 'x \\ ''y''  \n  z'\nc: \"\\L\\P\\N\\_\"\n");
+  CHECK(str(at(*spaces, "a")) == "one two \t\nthree ");
+  CHECK(str(at(*spaces, "b")) == "x \\ 'y' z");
+  CHECK(str(at(*spaces, "c")) == "\u2028\u2029\u0085\u00a0");
+
+  // long scalars outgrow the blocks of the pool, the scalars decoded before them stay intact
+  auto line = std::string(100, 'w');
+  auto source = std::string{};
+  auto expected = std::vector<std::string>{};
+  for (auto lines : { 2, 3, 50, 1000 }) {
+    source += "- \"" + line + "\\t";
+    expected.push_back(line + "\t");
+    for (auto i = 1; i < lines; ++i) {
+      source += "\n  " + line + "\\t";
+      expected.back() += " " + line + "\t";
+    }
+    source += "\"\n";
+  }
+  auto long_strings = yaml::load(source);
+  auto &items = long_strings->as<yaml::failsafe::sequence>();
+  REQUIRE(items.size() == expected.size());
+  for (auto i = std::size_t{ 0 }; i < items.size(); ++i) CHECK(str(*items[i]) == expected[i]);
+
+  CHECK_THROWS_AS(yaml::load("a: \"open\n  on"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load("a: 'open"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load("a: \"with \\q\""), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load(std::string_view{ "a: \"nul \0 inside\"", 17 }), yaml::parse_error);
+
+  // every quoted scalar finder of the running cpu agrees with the scalar one
+  auto content = std::string(256 + 17, '\0');
+  for (auto i = std::size_t{ 0 }; i < content.size(); ++i) content[i] = static_cast<char>(i * 13 % 256 | 1);
+  content[200] = '\0';
+  for (auto find : yaml::detail::simd::quoted_available())
+    for (auto quote : { '"', '\'' })
+      for (auto from = std::size_t{ 0 }; from <= content.size(); ++from)
+        CHECK(find(content.data(), content.size(), from, quote)
+              == yaml::detail::simd::find_quoted_scalar(content.data(), content.size(), from, quote));
+}
+
+TEST_CASE("Block scalars")
+{
+  auto document = yaml::load(
+    "literal: |\n"
+    "  one\n"
+    "   two\n"
+    "\n"
+    "strip: |-\n"
+    "  text\n"
+    "\n"
+    "keep: |+\n"
+    "  text\n"
+    "\n"
+    "folded: >\n"
+    "  one\n"
+    "  two\n"
+    "\n"
+    "  three\n"
+    "    more\n"
+    "  four\n"
+    "indicator: |2\n"
+    "    indented\n"
+    "last: >-\n"
+    "  end\n");
+  auto &root = *document;
+  CHECK(str(at(root, "literal")) == "one\n two\n");
+  CHECK(str(at(root, "strip")) == "text");
+  CHECK(str(at(root, "keep")) == "text\n\n");
+  CHECK(str(at(root, "folded")) == "one two\nthree\n  more\nfour\n");
+  CHECK(str(at(root, "indicator")) == "  indented\n");
+  CHECK(str(at(root, "last")) == "end");
+}
+
+TEST_CASE("Documents and directives")
+{
+  CHECK(str(*yaml::load("")).empty());
+  CHECK(str(*yaml::load("# only a comment\n")).empty());
+  CHECK(str(*yaml::load("%YAML 1.2\n--- text\n...\n")) == "text");
+  CHECK(str(*yaml::load("--- !!str\n")).empty());
+  CHECK(str(at(*yaml::load("%TAG !e! tag:example.com,2000:\n---\n- !e!foo bar\n"), 0)) == "bar");
+}
+
+TEST_CASE("Ill formed streams")
+{
+  CHECK_THROWS_AS(yaml::load("key: [unterminated"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load("key: \"unterminated"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load("*undefined"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load("a: b: c"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load("- !e!foo bar"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load("one\n---\ntwo"), yaml::parse_error);
+}
+
+TEST_CASE("Tape layout")
+{
+  auto content = fixture("invoice.yml");
+  auto invoice = yaml::load<yaml::tape_schema>(content);
+  auto root = invoice.root();
+
+  REQUIRE(root.is_mapping());
+  CHECK(root.size() == 8);
+  CHECK(root["invoice"].scalar() == "34843");
+  CHECK(root["bill-to"]["address"]["lines"].scalar() == "458 Walkman Dr.\nSuite #292\n");
+  CHECK(root["ship-to"] == root["bill-to"]);
+  CHECK(root["total"].scalar() == "4443.52");
+  CHECK_FALSE(root.find("missing"));
+
+  auto skus = std::vector<std::string_view>{};
+  for (auto product : root["product"].items()) skus.push_back(product["sku"].scalar());
+  CHECK(skus == std::vector<std::string_view>{ "BL394D", "BL4438H" });
+  CHECK(root["product"][1]["price"].scalar() == "2392.00");
+
+  // the whole document lives in one array, each collection knows where its subtree ends
+  auto entries = invoice.entries();
+  CHECK(entries.front().next == entries.size());
+  CHECK(yaml::load<yaml::tape_schema>("[a, [b, c], d]").root()[2].scalar() == "d");
+  CHECK(yaml::load<yaml::tape_schema>("").root().scalar().empty());
+}
+
+TEST_CASE("Structural index")
+{
+  // every byte value at every position of a block, all the kernels of the running cpu agree with the scalar one
+  auto content = std::string(256 + 64 + 17, '\0');
+  for (auto i = std::size_t{ 0 }; i < content.size(); ++i) content[i] = static_cast<char>(i * 7 % 256);
+  for (auto classify : yaml::detail::simd::available()) {
+    for (auto offset = std::size_t{ 0 }; offset + 64 <= content.size(); offset += 16) {
+      auto expected = yaml::detail::simd::classify_scalar(content.data() + offset);
+      auto masks = classify(content.data() + offset);
+      CHECK(masks.structural == expected.structural);
+      CHECK(masks.breaks == expected.breaks);
+    }
+  }
+
+  auto text = std::string(70, 'a') + ": b\n" + std::string(60, 'c') + "\n#";
+  auto index = yaml::detail::structural_index{ text };
+  CHECK(index.next_structural(0) == 70);
+  CHECK(index.next_structural(71) == 71);
+  CHECK(index.next_structural(74) == 134);
+  CHECK(index.next_break(0) == 73);
+  CHECK(index.next_break(74) == 134);
+  CHECK(index.next_structural(136) == text.size());
+  CHECK(index.next_break(135) == text.size());
+  CHECK(yaml::detail::structural_index{ "" }.next_structural(0) == 0);
+
+  // the blocks left behind are dropped, positions asked for again are found the same
+  auto lines = std::string{};
+  for (auto i = 0; i < 2000; ++i) lines += "key" + std::to_string(i) + ": [value, " + std::string(i % 90, 'v') + "]\n";
+  auto scan = yaml::detail::structural_index{ lines };
+  auto found = std::size_t{ 0 };
+  for (auto at = scan.next_break(0); at < lines.size(); at = scan.next_break(at + 1)) {
+    if (at + 1 < lines.size()) CHECK(scan.next_structural(at + 1) == lines.find_first_of(":[,]", at + 1));
+    ++found;
+  }
+  CHECK(found == 2000);
+  CHECK(scan.next_break(0) == lines.find('\n'));
+  CHECK(scan.next_structural(lines.size() / 2) == lines.find_first_of(":[,]\n", lines.size() / 2));
+
+  // long scalars and comments crossing block boundaries
+  auto long_value = std::string(150, 'x') + " y";
+  auto source = "key: " + long_value + " # " + std::string(100, '-') + "\nother: 'it''s " + long_value + "'\n";
+  auto loaded = yaml::load(source);
+  CHECK(str(at(*loaded, "key")) == long_value);
+  CHECK(str(at(*loaded, "other")) == "it's " + long_value);
+}
+
+TEST_CASE("Document streams")
+{
+  auto logs = std::ifstream{ std::filesystem::path{ YAML_TEST_FILES } / "logs.yml", std::ios::binary };
+  auto users = std::vector<std::string>{};
+  for (auto &entry : yaml::stream{ logs, 7 }) users.emplace_back(str(at(*entry, "User")));
+  CHECK(users == std::vector<std::string>{ "ed", "ed", "ed" });
+
+  // documents own their content once the stream has moved on
+  auto content = std::string{ "# leading comment\na: 1\n--- b\n...\n%YAML 1.2\n---\n- c\n...\n# trailing comment\n" };
+  auto read = [&content, at = std::size_t{ 0 }](std::span<char> _chunk) mutable {
+    auto count = content.copy(_chunk.data(), std::min<std::size_t>(_chunk.size(), 3), at);
+    at += count;
+    return count;
+  };
+  auto documents = yaml::stream{ read, 5 };
+  auto first = documents.next();
+  auto second = documents.next();
+  auto third = documents.next();
+  CHECK_FALSE(documents.next());
+  CHECK_FALSE(documents.next());
+  REQUIRE(first);
+  REQUIRE(second);
+  REQUIRE(third);
+  content.assign(content.size(), 'x');
+  CHECK(str(at(**first, "a")) == "1");
+  CHECK(str(**second) == "b");
+  CHECK(str(at(**third, 0)) == "c");
+
+  auto tapes = std::istringstream{ "--- [a]\n--- [b, c]\n" };
+  auto sizes = std::vector<std::size_t>{};
+  for (auto &entry : yaml::stream<yaml::tape_schema>{ tapes }) sizes.push_back(entry.root().size());
+  CHECK(sizes == std::vector<std::size_t>{ 1, 2 });
+
+  // errors are located in the whole stream
+  auto broken = std::istringstream{ "--- a\n--- [b\n" };
+  auto failing = yaml::stream{ broken };
+  CHECK(failing.next());
+  try {
+    failing.next();
+    FAIL("the second document is ill formed");
+  } catch (const yaml::parse_error &_error) {
+    CHECK(_error.where().line == 2);
+  }
+
+  // utf-16 streams are transcoded as they are read, chunks cut code units and surrogate pairs
+  auto utf16 = encode("\xEF\xBB\xBF" "a: caf\xC3\xA9\n--- \xF0\x9F\x98\x80\n...\n--- [b, c]\n", 2, false);
+  for (auto size = std::size_t{ 1 }; size <= 7; ++size) {
+    auto input = std::istringstream{ utf16 };
+    auto loaded = std::vector<std::string>{};
+    for (auto &entry : yaml::stream{ input, size }) loaded.push_back(yaml::dump(*entry, { .flow = true }));
+    CHECK(loaded == std::vector<std::string>{ "{a: caf\xC3\xA9}\n", "\xF0\x9F\x98\x80\n", "[b, c]\n" });
+  }
+  auto truncated = std::istringstream{ encode("--- a\n--- b\n", 2, false) + "c" };
+  auto partial = yaml::stream{ truncated };
+  CHECK(partial.next());
+  CHECK_THROWS_AS(partial.next(), yaml::parse_error);
+}
+
+TEST_CASE("Loading files")
+{
+  auto path = std::filesystem::path{ YAML_TEST_FILES } / "invoice.yml";
+  auto invoice = yaml::load_file(path);
+  CHECK(str(at(*invoice, "invoice")) == "34843");
+  CHECK(str(at(at(*invoice, "bill-to"), "given")) == "Chris");
+  CHECK(yaml::load_file<yaml::tape_schema>(path).root()["total"].scalar() == "4443.52");
+  CHECK(yaml::detail::file_content{ path }.view() == fixture("invoice.yml"));
+  CHECK_THROWS_AS(yaml::load_file(path.parent_path() / "missing.yml"), std::filesystem::filesystem_error);
+}
+
+TEST_CASE("Event reader")
+{
+  auto content = std::string_view{ "a: [1, 2]\nb: {c: 'd'}\ne: &x f\ng: *x\n" };
+
+  auto types = std::vector<yaml::event_type>{};
+  for (auto &event : yaml::event_reader{ content }) types.push_back(event.type);
+  using enum yaml::event_type;
+  CHECK(types
+        == std::vector{ stream_start, document_start, mapping_start, scalar, sequence_start, scalar, scalar,
+          sequence_end, scalar, mapping_start, scalar, scalar, mapping_end, scalar, scalar, scalar, alias, mapping_end,
+          document_end, stream_end });
+
+  // picking a single key, the other values are skipped without being looked at
+  auto reader = yaml::event_reader{ content };
+  reader.next();
+  reader.next();
+  reader.next();
+  auto found = std::string_view{};
+  while (reader.peek().type != mapping_end) {
+    auto key = reader.next().value;
+    if (key == "e") {
+      auto value = reader.next();
+      CHECK(value.anchor == "x");
+      found = value.value;
+    } else
+      reader.skip();
+  }
+  CHECK(found == "f");
+
+  auto scalars = std::size_t{ 0 };
+  CHECK(yaml::parse(content, [&](const yaml::event &_event) { scalars += _event.type == scalar; }));
+  CHECK(scalars == 9);
+  auto seen = std::size_t{ 0 };
+  CHECK_FALSE(yaml::parse(content, [&](const yaml::event &_event) {
+    ++seen;
+    return _event.type != sequence_start;
+  }));
+  CHECK(seen == 5);
+  CHECK_THROWS_AS(yaml::parse("[a", [](const yaml::event &) {}), yaml::parse_error);
+}
+
+TEST_CASE("On demand navigation")
+{
+  auto content = fixture("invoice.yml");
+  auto invoice = yaml::load<yaml::ondemand>(content);
+  CHECK(invoice["invoice"].scalar() == "34843");
+  CHECK(invoice["bill-to"]["address"]["city"].scalar() == "Royal Oak");
+  CHECK(invoice["bill-to"]["address"]["lines"].scalar() == "458 Walkman Dr.\nSuite #292\n");
+  CHECK(invoice["ship-to"]["given"].scalar() == "Chris");
+  CHECK(invoice["product"][1]["description"].scalar() == "Super Hoop");
+  CHECK(invoice["product"][0]["quantity"].scalar() == "4");
+  CHECK(invoice["comments"].scalar().starts_with("Late afternoon is best."));
+  CHECK(invoice["product"].is_sequence());
+  CHECK(invoice["bill-to"].is_mapping());
+  CHECK_FALSE(invoice.find("missing"));
+  CHECK_THROWS_AS(invoice["product"][2], std::out_of_range);
+  CHECK_THROWS_AS(invoice["invoice"]["key"], std::invalid_argument);
+
+  // flow collections, quoted keys and indentless sequences
+  auto mixed = std::string_view{ "%YAML 1.2\n---\n"
+                                 "\"quoted key\": {a: [1, {b: c}], d: e}\n"
+                                 "list:\n- one\n- - two\n  - three\n"
+                                 "block: |2\n    kept\n"
+                                 "empty:\n"
+                                 "last: 'it''s'\n" };
+  auto document = yaml::load<yaml::ondemand>(mixed);
+  CHECK(document["quoted key"]["a"][1]["b"].scalar() == "c");
+  CHECK(document["quoted key"]["d"].scalar() == "e");
+  CHECK(document["list"][0].scalar() == "one");
+  CHECK(document["list"][1][1].scalar() == "three");
+  CHECK(document["block"].scalar() == "  kept\n");
+  CHECK(document["empty"].scalar().empty());
+  CHECK(document["last"].scalar() == "it's");
+
+  // siblings are skipped without being parsed
+  auto skipped = yaml::load<yaml::ondemand>(std::string_view{ "a:\n  b: {x: [}\nc: d\n" });
+  CHECK(skipped["c"].scalar() == "d");
+  CHECK_THROWS_AS(skipped["a"]["b"]["x"][0], yaml::parse_error);
+
+  // scalars are decoded once, anchors are found by a single scan whatever the number of aliases
+  auto anchored = std::string{ "escaped: \"a\\tb\"\n" };
+  for (auto i = 0; i < 200; ++i) {
+    auto name = std::to_string(i % 10);
+    anchored += "k" + std::to_string(i) + ": &a" + name + " v" + std::to_string(i) + "\n";
+  }
+  for (auto i = 0; i < 200; ++i) anchored += "r" + std::to_string(i) + ": *a" + std::to_string(i % 10) + "\n";
+  auto aliased = yaml::load<yaml::ondemand>(std::string_view{ anchored });
+  auto escaped = aliased["escaped"].scalar();
+  CHECK(escaped == "a\tb");
+  CHECK(aliased["escaped"].scalar().data() == escaped.data());
+  for (auto i = 0; i < 200; ++i)
+    CHECK(aliased["r" + std::to_string(i)].scalar() == "v" + std::to_string(190 + i % 10));
+  auto undefined = yaml::load<yaml::ondemand>(std::string_view{ "a: *b\nb: &b c\n" });
+  CHECK_THROWS_AS(undefined["a"].scalar(), yaml::parse_error);
+  auto contexts = yaml::load<yaml::ondemand>(std::string_view{ "a: &m one\n  two\nb: !!seq\n- &s x\n- y\n"
+                                                                "c:\n- k: &n v\n  j: w\n- {f: &f [1, 2]}\n"
+                                                                "d: [*m, *s, *n, *f]\n" });
+  CHECK(contexts["b"][0].scalar() == "x");
+  CHECK(contexts["d"][0].scalar() == "one two");
+  CHECK(contexts["d"][1].scalar() == "x");
+  CHECK(contexts["d"][2].scalar() == "v");
+  CHECK(contexts["d"][3][1].scalar() == "2");
+}
+
+TEST_CASE("Key index")
+{
+  auto content = std::string{ "[a]: collection key\nfirst: 1\n" };
+  for (auto i = 0; i < 20'000; ++i) content += "key" + std::to_string(i) + ": " + std::to_string(i) + "\n";
+  content += "first: duplicate\n";
+  auto loaded = yaml::load(content);
+  auto index = yaml::key_index{ loaded->as<yaml::failsafe::mapping>() };
+
+  for (auto i = 0; i < 20'000; i += 997) {
+    auto *value = index.find("key" + std::to_string(i));
+    REQUIRE(value);
+    CHECK(str(*value) == std::to_string(i));
+  }
+  CHECK(str(*index.find("first")) == "1");
+  CHECK_FALSE(index.contains("key20000"));
+  CHECK_FALSE(index.contains("a"));
+  CHECK_FALSE(yaml::key_index{}.contains("first"));
+
+  // iteration still follows the mapping
+  CHECK(str(*index.mapping()[1].first) == "first");
+  CHECK(str(*index.mapping()[2].first) == "key0");
+}
+
+TEST_CASE("Aliases")
+{
+  using yaml::failsafe;
+  auto content = std::string_view{ "base: &b {x: 1}\nscalar: &s text\ncopies: [*b, *s, *b]\nredefined: &b y\nlast: *b\n" };
+  auto loaded = yaml::load(content);
+  auto &copies = at(*loaded, "copies").as<failsafe::sequence>();
+  CHECK(copies[0] == at_ref(*loaded, "base"));
+  CHECK(copies[2] == at_ref(*loaded, "base"));
+  CHECK(copies[1] == at_ref(*loaded, "scalar"));
+  CHECK(str(at(*loaded, "last")) == "y");
+
+  // 9 levels of 9 aliases would expand to 9^9 nodes
+  auto laughs = std::string{ "a0: &a0 [lol, lol, lol, lol, lol, lol, lol, lol, lol]\n" };
+  for (auto level = 1; level < 10; ++level) {
+    auto previous = "*a" + std::to_string(level - 1);
+    laughs += "a" + std::to_string(level) + ": &a" + std::to_string(level) + " [" + previous;
+    for (auto i = 1; i < 9; ++i) laughs += ", " + previous;
+    laughs += "]\n";
+  }
+  CHECK_THROWS_AS(yaml::load(laughs), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load<yaml::tape_schema>(laughs), yaml::parse_error);
+
+  // the expansion counts every node reached through an alias
+  CHECK_NOTHROW(failsafe{ .max_alias_expansion = 8 }.load(content));
+  CHECK_THROWS_AS(failsafe{ .max_alias_expansion = 7 }.load(content), yaml::parse_error);
+  CHECK_NOTHROW(yaml::tape_schema{ .max_alias_expansion = 8 }.load(content));
+  CHECK_THROWS_AS(yaml::tape_schema{ .max_alias_expansion = 7 }.load(content), yaml::parse_error);
+
+  // a collection cannot refer to itself
+  CHECK_THROWS_AS(yaml::load("&a [*a]"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load<yaml::tape_schema>("&a [*a]"), yaml::parse_error);
+}
+
+TEST_CASE("Core and JSON schemas")
+{
+  using yaml::core;
+  auto content = std::string_view{ "nulls: [~, null, Null, NULL, ]\n"
+                                   "bools: [true, True, FALSE, false]\n"
+                                   "ints: [0, -12, +7, 0o17, 0x1F, 9223372036854775807]\n"
+                                   "floats: [1.5, -.5, 2e3, +1., .inf, -.Inf, .NaN, 99999999999999999999]\n"
+                                   "strs: [nul, yes, 0o8, 0x, 1.2.3, '12', \"true\", !!str 3, !local 4]\n"
+                                   "taggeds: [!!int 10, !!float 1, !!bool false, !!null ~]\n" };
+  auto loaded = core{}.load(content);
+  auto field = [&](std::string_view _key) {
+    for (auto &[key, value] : loaded->as<core::mapping>())
+      if (key->as<core::scalar>() == _key) return value->as<core::sequence>();
+    throw std::out_of_range{ std::string{ _key } };
+  };
+
+  for (auto *value : field("nulls")) CHECK(value->is<core::null>());
+  auto bools = field("bools");
+  CHECK(bools[0]->as<core::boolean>());
+  CHECK(bools[1]->as<core::boolean>());
+  CHECK_FALSE(bools[2]->as<core::boolean>());
+  CHECK_FALSE(bools[3]->as<core::boolean>());
+
+  auto ints = field("ints");
+  CHECK(ints[0]->as<core::integer>() == 0);
+  CHECK(ints[1]->as<core::integer>() == -12);
+  CHECK(ints[2]->as<core::integer>() == 7);
+  CHECK(ints[3]->as<core::integer>() == 15);
+  CHECK(ints[4]->as<core::integer>() == 31);
+  CHECK(ints[5]->as<core::integer>() == 9223372036854775807);
+
+  auto floats = field("floats");
+  CHECK(floats[0]->as<core::floating>() == 1.5);
+  CHECK(floats[1]->as<core::floating>() == -0.5);
+  CHECK(floats[2]->as<core::floating>() == 2000.0);
+  CHECK(floats[3]->as<core::floating>() == 1.0);
+  CHECK(floats[4]->as<core::floating>() == std::numeric_limits<double>::infinity());
+  CHECK(floats[5]->as<core::floating>() == -std::numeric_limits<double>::infinity());
+  CHECK(std::isnan(floats[6]->as<core::floating>()));
+  CHECK(floats[7]->as<core::floating>() == 1e20);
+
+  auto strings = field("strs");
+  auto expected = { "nul", "yes", "0o8", "0x", "1.2.3", "12", "true", "3", "4" };
+  CHECK(std::ranges::equal(strings, expected, {}, [](auto *_node) { return _node->template as<core::scalar>(); }));
+
+  auto tagged = field("taggeds");
+  CHECK(tagged[0]->as<core::integer>() == 10);
+  CHECK(tagged[1]->as<core::floating>() == 1.0);
+  CHECK_FALSE(tagged[2]->as<core::boolean>());
+  CHECK(tagged[3]->is<core::null>());
+  CHECK_THROWS_AS(core{}.load("!!int ten"), yaml::parse_error);
+
+  // integers out of range are floats in every base, a !!int tag then fails the load where the scalar is
+  auto overflows = core{}.load("[9223372036854775808, 0x10000000000000000, 0o1000000000000000000000,"
+                               " 0x7FFFFFFFFFFFFFFF]");
+  auto &large = overflows->as<core::sequence>();
+  CHECK(large[0]->as<core::floating>() == 9223372036854775808.0);
+  CHECK(large[1]->as<core::floating>() == 18446744073709551616.0);
+  CHECK(large[2]->as<core::floating>() == 9223372036854775808.0);
+  CHECK(large[3]->as<core::integer>() == std::numeric_limits<std::int64_t>::max());
+  CHECK(core{}.load("!!float 0x10000000000000000")->as<core::floating>() == 18446744073709551616.0);
+  // floats out of range are infinite when too large and zeros keeping their sign when too small
+  auto extremes = core{}.load("[1e-400, -1e-400, 1e400, -0.0000001e400, 4e-324, 0.00001e-320]");
+  auto &limits = extremes->as<core::sequence>();
+  CHECK(limits[0]->as<core::floating>() == 0.0);
+  CHECK_FALSE(std::signbit(limits[0]->as<core::floating>()));
+  CHECK(limits[1]->as<core::floating>() == 0.0);
+  CHECK(std::signbit(limits[1]->as<core::floating>()));
+  CHECK(limits[2]->as<core::floating>() == std::numeric_limits<double>::infinity());
+  CHECK(limits[3]->as<core::floating>() == -std::numeric_limits<double>::infinity());
+  CHECK(limits[4]->as<core::floating>() > 0.0);
+  CHECK(limits[5]->as<core::floating>() == 0.0);
+  auto json_zero = yaml::json{}.load("-1e-400")->as<yaml::json::floating>();
+  CHECK(json_zero == 0.0);
+  CHECK(std::signbit(json_zero));
+  auto out_of_range = { "9223372036854775808", "-9223372036854775809", "0x8000000000000000", "0o1000000000000000000000" };
+  for (auto value : out_of_range) {
+    try {
+      core{}.load("a: 1\nb: !!int " + std::string{ value } + "\n");
+      FAIL("the integer is out of range");
+    } catch (const yaml::parse_error &_error) {
+      CHECK(_error.where().line == 1);
+    }
+  }
+  CHECK(core{}.load("")->is<core::null>());
+
+  // the non-specific ! tag resolves to a string
+  auto bangs = core{}.load("[12, ! 12, ! true, ! '1']");
+  auto &items = bangs->as<core::sequence>();
+  CHECK(items[0]->as<core::integer>() == 12);
+  CHECK(items[1]->as<core::scalar>() == "12");
+  CHECK(items[2]->as<core::scalar>() == "true");
+  CHECK(items[3]->as<core::scalar>() == "1");
+
+  // json only knows the json forms
+  using yaml::json;
+  auto document = json{}.load("{\"a\": [null, true, false, -0, 12, 1.5e-3, \"x\", ]}");
+  auto &entries = document->as<json::mapping>();
+  auto values = entries[0].second->as<json::sequence>();
+  CHECK(values[0]->is<json::null>());
+  CHECK(values[1]->as<json::boolean>());
+  CHECK_FALSE(values[2]->as<json::boolean>());
+  CHECK(values[3]->as<json::integer>() == 0);
+  CHECK(values[4]->as<json::integer>() == 12);
+  CHECK(values[5]->as<json::floating>() == 1.5e-3);
+  CHECK(values[6]->as<json::scalar>() == "x");
+  CHECK(json{}.load("")->is<json::null>());
+  // plain scalars of no json form fail the load where they are
+  auto invalid = { std::pair{ "{\"b\": True}", 6 }, std::pair{ "{\"c\": 012}", 6 }, std::pair{ "[1, .5]", 4 },
+    std::pair{ "{b: 1}", 1 } };
+  for (auto [content, index] : invalid) {
+    try {
+      json{}.load(content);
+      FAIL("the plain scalar has no json form");
+    } catch (const yaml::parse_error &_error) {
+      CHECK(_error.where().index == static_cast<std::size_t>(index));
+    }
+  }
+}
+
+namespace {
+
+struct address
+{
+  std::string lines;
+  std::string city;
+  std::string state;
+  int postal = 0;
+
+  static constexpr auto yaml_fields()
+  {
+    return std::tuple{ yaml::field{ "lines", &address::lines }, yaml::field{ "city", &address::city },
+      yaml::field{ "state", &address::state }, yaml::field{ "postal", &address::postal } };
+  }
+};
+
+struct person
+{
+  std::string given;
+  std::string family;
+  address location;
+
+  static constexpr auto yaml_fields()
+  {
+    return std::tuple{ yaml::field{ "given", &person::given }, yaml::field{ "family", &person::family },
+      yaml::field{ "address", &person::location } };
+  }
+};
+
+struct product
+{
+  std::string sku;
+  unsigned quantity = 0;
+  std::string description;
+  double price = 0;
+
+  static constexpr auto yaml_fields()
+  {
+    return std::tuple{ yaml::field{ "sku", &product::sku }, yaml::field{ "quantity", &product::quantity },
+      yaml::field{ "description", &product::description }, yaml::field{ "price", &product::price } };
+  }
+};
+
+struct invoice
+{
+  std::int64_t number = 0;
+  std::string date;
+  person bill_to;
+  person ship_to;
+  std::vector<product> products;
+  double tax = 0;
+  double total = 0;
+  std::optional<std::string> comments;
+  std::optional<std::string> notes = "none";
+  std::map<std::string, bool> flags;
+
+  static constexpr auto yaml_fields()
+  {
+    return std::tuple{ yaml::field{ "invoice", &invoice::number }, yaml::field{ "date", &invoice::date },
+      yaml::field{ "bill-to", &invoice::bill_to }, yaml::field{ "ship-to", &invoice::ship_to },
+      yaml::field{ "product", &invoice::products }, yaml::field{ "tax", &invoice::tax },
+      yaml::field{ "total", &invoice::total }, yaml::field{ "comments", &invoice::comments },
+      yaml::field{ "notes", &invoice::notes }, yaml::field{ "flags", &invoice::flags } };
+  }
+};
+
+}// namespace
+
+TEST_CASE("Loading into structs")
+{
+  auto content = fixture("invoice.yml") + "\nnotes: ~\nflags: {paid: true, sent: no_such_bool}\n";
+  CHECK_THROWS_AS(yaml::load_into<invoice>(content), yaml::parse_error);
+
+  content = fixture("invoice.yml") + "\nnotes: ~\nflags: {paid: true, sent: False}\nextra: [1, {2: 3}]\n";
+  auto loaded = yaml::load_into<invoice>(content);
+  CHECK(loaded.number == 34843);
+  CHECK(loaded.date == "2001-01-23");
+  CHECK(loaded.bill_to.given == "Chris");
+  CHECK(loaded.bill_to.location.lines == "458 Walkman Dr.\nSuite #292\n");
+  CHECK(loaded.bill_to.location.postal == 48046);
+  CHECK(loaded.ship_to.family == "Dumars");
+  CHECK(loaded.ship_to.location.city == "Royal Oak");
+  REQUIRE(loaded.products.size() == 2);
+  CHECK(loaded.products[0].sku == "BL394D");
+  CHECK(loaded.products[0].quantity == 4);
+  CHECK(loaded.products[1].price == 2392.0);
+  CHECK(loaded.tax == 251.42);
+  CHECK(loaded.comments == "Late afternoon is best. Backup contact is Nancy Billsmer @ 338-4338.");
+  CHECK_FALSE(loaded.notes);
+  CHECK(loaded.flags == std::map<std::string, bool>{ { "paid", true }, { "sent", false } });
+
+  // the same schema drives yaml::load and streams
+  CHECK(yaml::load<yaml::bound<product>>("{sku: A1, price: 3}").price == 3.0);
+  CHECK(yaml::load_into<std::vector<int>>("[1, 0x10, -3]") == std::vector<int>{ 1, 16, -3 });
+  CHECK(yaml::load_into<product>("").sku.empty());
+  CHECK_THROWS_AS(yaml::load_into<product>("{quantity: -1}"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load_into<product>("{quantity: '1'}"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load_into<product>("[sku]"), yaml::parse_error);
+
+  // aliases replay their anchor, redefinitions apply to the following aliases only
+  auto items = yaml::load_into<std::vector<product>>("- &p {sku: &s A, quantity: 2}\n- *p\n- &p {sku: *s}\n- *p\n");
+  REQUIRE(items.size() == 4);
+  CHECK(items[1].sku == "A");
+  CHECK(items[1].quantity == 2);
+  CHECK(items[2].sku == "A");
+  CHECK(items[3].quantity == 0);
+  CHECK_THROWS_AS(yaml::load_into<std::vector<std::vector<int>>>("&a [*a]"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::bound<std::vector<product>>{ .max_alias_expansion = 2 }.load("[&p {sku: A}, *p]"),
+    yaml::parse_error);
+}
+
+namespace {
+
+// the events of a stream with the fields the emitter has to preserve
+std::string summary(const yaml::event &_event)
+{
+  auto result = std::to_string(static_cast<int>(_event.type)) + "|" + std::string{ _event.anchor } + "|"
+                + std::string{ _event.tag } + "|" + std::string{ _event.value };
+  if (_event.type == yaml::event_type::scalar) result += _event.implicit ? "|implicit" : "|quoted";
+  return result;
+}
+
+std::vector<std::string> event_summary(std::string_view _content)
+{
+  auto result = std::vector<std::string>{};
+  yaml::parse(_content, [&](const yaml::event &_event) { result.push_back(summary(_event)); });
+  return result;
+}
+
+// the summary of the event with the position it starts at
+std::string located(const yaml::event &_event)
+{
+  return summary(_event) + "@" + std::to_string(_event.start.index) + ":" + std::to_string(_event.start.line) + ":"
+         + std::to_string(_event.start.column);
+}
+
+std::string reemit(std::string_view _content, yaml::emit_options _options = {})
+{
+  auto result = std::string{};
+  auto writer = yaml::emitter{ std::back_inserter(result), _options };
+  yaml::parse(_content, [&](const yaml::event &_event) { writer.emit(_event); });
+  return result;
+}
+
+}// namespace
+
+TEST_CASE("Emitter")
+{
+  auto loaded = yaml::load("a: [1, {b: c}]\nd:\n  - x\n  - []\ne: {}\n");
+  CHECK(yaml::dump(*loaded) == "a:\n  - 1\n  - b: c\nd:\n  - x\n  - []\ne: {}\n");
+  CHECK(yaml::dump(*loaded, { .flow = true }) == "{a: [1, {b: c}], d: [x, []], e: {}}\n");
+  CHECK(yaml::dump(*yaml::load("- - a\n  - b\n- c\n")) == "- - a\n  - b\n- c\n");
+
+  // scalars are quoted only when the plain form would read differently
+  auto scalars = yaml::load("- 'a: b'\n- '#x'\n- ' x'\n- 'it''s'\n- \"tab\\there\"\n- \"bell\\a\"\n- ''\n- a#b\n- -1\n"
+                            "- 'x,y'\n- '?x'\n");
+  CHECK(yaml::dump(*scalars)
+        == "- 'a: b'\n- '#x'\n- ' x'\n- it's\n- 'tab\there'\n- \"bell\\x07\"\n- ''\n- a#b\n- -1\n- x,y\n- ?x\n");
+  CHECK(yaml::dump(*scalars, { .flow = true })
+        == "['a: b', '#x', ' x', it's, 'tab\there', \"bell\\x07\", '', a#b, -1, 'x,y', '?x']\n");
+  CHECK(yaml::dump(*yaml::load("text: |\n  two\n  lines\nkept: |+\n  a\n\nstrip: \"a\\nb\"\n"))
+        == "text: |\n  two\n  lines\nkept: |+\n  a\n\nstrip: |-\n  a\n  b\n");
+
+  // shared collections are written once
+  auto shared = yaml::load("a: &x [1, 2]\nb: *x\nc: *x\n");
+  CHECK(yaml::dump(*shared) == "a: &id1\n  - 1\n  - 2\nb: *id1\nc: *id1\n");
+
+  // native values keep their type, strings looking like other types are quoted
+  auto native = yaml::core{}.load("[1, 2.5, 3e2, ~, true, '12', 'null', text, .inf, 0x10]");
+  CHECK(yaml::dump(*native, { .flow = true }) == "[1, 2.5, 300.0, null, true, '12', 'null', text, .inf, 16]\n");
+  CHECK(yaml::dump(*yaml::json{}.load("{\"a\": [1, \"b\"]}"), { .flow = true }) == "{'a': [1, 'b']}\n");
+
+  // trees round trip through load
+  auto invoice = fixture("invoice.yml");
+  auto original = yaml::load(invoice);
+  auto written = yaml::dump(*original);
+  auto reloaded = yaml::load(written);
+  CHECK(yaml::dump(*reloaded) == written);
+  CHECK(str(at(at(at(*reloaded, "bill-to"), "address"), "lines")) == "458 Walkman Dr.\nSuite #292\n");
+  CHECK(at_ref(*reloaded, "ship-to") == at_ref(*reloaded, "bill-to"));
+  CHECK(yaml::dump(*yaml::load(yaml::dump(*original, { .flow = true }))) == written);
+
+  // event streams round trip with their anchors, tags and documents
+  auto streams = std::vector<std::string>{ "--- !<tag:clarkevans.com,2002:invoice>\na: &a !!str 1\nb: *a\n? [k]\n: v\n...\n--- x\n",
+    "{a: [b, {c: d}], [k]: f, &e e: *e, x: ['?x', ':y']}",
+    "- &s\n  a: 1\n- ? a\n  : b\n- \"\"\n- !local x\n- !!null\n",
+    "%YAML 1.2\n--- |\n  literal\n   text\n", fixture("invoice.yml"), fixture("logs.yml") };
+  for (auto &content : streams) {
+    auto block = reemit(content);
+    CHECK(event_summary(block) == event_summary(content));
+    CHECK(event_summary(reemit(content, { .flow = true })) == event_summary(content));
+    CHECK(reemit(block) == block);
+  }
+  // empty plain scalars have no flow sequence form
+  CHECK(reemit("- a\n-\n") == "- a\n-\n");
+  CHECK(reemit("- a\n-\n", { .flow = true }) == "[a, '']\n");
+
+  // the output goes through the reusable buffer in chunks
+  auto large = std::string{};
+  for (auto i = 0; i < 10'000; ++i) large += "- key" + std::to_string(i) + ": value\n";
+  auto chunks = std::size_t{ 0 };
+  auto output = std::string{};
+  auto writer = yaml::emitter{ [&](std::string_view _chunk) {
+    ++chunks;
+    output += _chunk;
+  } };
+  writer.dump(*yaml::load(large));
+  writer.flush();
+  CHECK(output == large);
+  CHECK(chunks > 1);
+}
+
+TEST_CASE("Parallel loading")
+{
+  auto logs = fixture("logs.yml");
+  auto documents = yaml::load_all_parallel(logs, 4);
+  REQUIRE(documents.size() == 3);
+  CHECK(str(at(*documents[0], "Time")) == "2001-11-23 15:01:42 -5");
+  CHECK(str(at(*documents[2], "Date")) == "2001-11-23 15:03:17 -5");
+
+  // the same documents as a stream, directives apply to their own document only
+  auto content = std::string{ "# leading comment\na: 1\n--- b\n...\n%TAG ! tag:example.com,2000:\n---\n- !x c\n...\n"
+                              "# comment\n--- !x d\n" };
+  for (auto i = 0; i < 500; ++i) content += "--- {index: " + std::to_string(i) + "}\n";
+  auto input = std::istringstream{ content };
+  auto expected = std::vector<std::string>{};
+  for (auto &entry : yaml::stream{ input }) expected.push_back(yaml::dump(*entry));
+  for (auto threads : { 1, 3, 8 }) {
+    auto loaded = yaml::load_all_parallel<yaml::failsafe>(content, threads);
+    auto written = std::vector<std::string>{};
+    for (auto &entry : loaded) written.push_back(yaml::dump(*entry));
+    CHECK(written == expected);
+  }
+  auto tagged = yaml::load_all_parallel<yaml::tape_schema>(content, 2);
+  REQUIRE(tagged.size() == 504);
+  CHECK(yaml::load_all_parallel("").empty());
+  CHECK(yaml::load_all_parallel("# only a comment\n...\n").empty());
+
+  // the first ill formed document in the stream is reported with its position in the stream
+  auto broken = std::string{};
+  for (auto i = 0; i < 200; ++i) broken += i == 120 || i == 150 ? "--- [b\n" : "--- a\n";
+  try {
+    yaml::load_all_parallel(broken, 8);
+    FAIL("documents are ill formed");
+  } catch (const yaml::parse_error &_error) {
+    CHECK(_error.where().line == 121);
+  }
+}
+
+TEST_CASE("Editing documents")
+{
+  auto content = std::string{ "# settings\n" };
+  for (auto i = 0; i < 2000; ++i) content += "key" + std::to_string(i) + ":\n  name: n" + std::to_string(i) + "\n";
+  auto edited = yaml::editable_document{ content };
+  auto edit = [&](std::string_view _at, std::size_t _length, std::string_view _text) {
+    auto offset = content.find(_at);
+    REQUIRE(offset != std::string::npos);
+    edited.apply({ offset, _length, _text });
+    content.replace(offset, _length, _text);
+    CHECK(edited.content() == content);
+    CHECK(edited.size() == content.size());
+    CHECK(yaml::dump(*edited) == yaml::dump(*yaml::load(content)));
+  };
+
+  // the entries away from the edit keep their nodes
+  auto *kept = &at(*edited, "key10");
+  edit("n1500", 5, "renamed");
+  CHECK(str(at(at(*edited, "key1500"), "name")) == "renamed");
+  edit("key700:", 0, "inserted: [a, b]\n");
+  edit("  name: n800\n", 0, "  extra: e\n");
+  edit("key900:\n  name: n900\n", 21, "");
+  edit("\nkey1000:\n  name:", 17, "");
+  edit("key1100:", 0, "  ");
+  CHECK(&at(*edited, "key10") == kept);
+  CHECK(str(at(at(*edited, "key999"), "name")) == "n999 n1000");
+  CHECK(edited->as<yaml::failsafe::mapping>().size() == 1998);
+
+  // edits reaching other entries or the lines before the first entry reload the whole content
+  edit("n20\n", 3, "&anchor n20");
+  edit("n30\n", 3, "*anchor");
+  CHECK(str(at(at(*edited, "key30"), "name")) == "n20");
+  edit("# settings", 10, "--- # settings");
+  edit("n40\n", 3, "[spanning,\nlines]");
+
+  // an ill formed edit leaves the document unchanged
+  auto before = edited.content();
+  CHECK_THROWS_AS(edited.apply({ content.find("name: n50"), 0, "[" }), yaml::parse_error);
+  CHECK_THROWS_AS(edited.apply({ content.find("key60:"), 0, "  - x\n" }), yaml::parse_error);
+  CHECK_THROWS_AS(edited.apply({ content.size(), 1, "" }), std::out_of_range);
+  CHECK(edited.content() == before);
+  CHECK(yaml::dump(*edited) == yaml::dump(*yaml::load(before)));
+
+  // any document can be edited, the ones without a top level block collection are reloaded
+  auto sequence = yaml::editable_document<yaml::core>{ "- 1\n- 2\n" };
+  sequence.apply({ 8, 0, "- 3\n" });
+  CHECK(sequence->as<yaml::core::sequence>().size() == 3);
+  CHECK(sequence->as<yaml::core::sequence>()[2]->as<yaml::core::integer>() == 3);
+  auto scalar = yaml::editable_document{ "text" };
+  scalar.apply({ 4, 0, " more" });
+  CHECK(str(*scalar) == "text more");
+
+  // inserting and removing entries over and over keeps the arena bounded
+  auto large = std::string{};
+  for (auto i = 0; i < 20000; ++i) large += "key" + std::to_string(i) + ": value\n";
+  auto daemon = yaml::editable_document{ large };
+  auto initial = daemon.arena_size();
+  auto largest = initial;
+  for (auto i = 0; i < 5000; ++i) {
+    auto offset = large.find("key" + std::to_string(i * 3 % 20000) + ":");
+    daemon.apply({ offset, 0, "added: x\n" });
+    daemon.apply({ offset, 9, "" });
+    largest = std::max(largest, daemon.arena_size());
+  }
+  CHECK(daemon.content() == large);
+  CHECK(daemon->as<yaml::failsafe::mapping>().size() == 20000);
+  CHECK(largest <= 3 * initial + 256 * 1024);
+}
+
+TEST_CASE("Parallel document loading")
+{
+  auto same = [](std::string_view _content) {
+    auto expected = yaml::dump(*yaml::load(_content));
+    for (auto threads : { 1, 2, 8 }) CHECK(yaml::dump(*yaml::load_parallel(_content, threads)) == expected);
+  };
+
+  // large top level collections are split on their entries
+  auto mapping = std::string{ "# header\n---\n" };
+  for (auto i = 0; i < 20000; ++i)
+    mapping += "key" + std::to_string(i) + ":\n  name: n" + std::to_string(i) + "\n  list: [a, b]\n  text: |\n    x\n";
+  same(mapping);
+  auto sequence = std::string{};
+  for (auto i = 0; i < 40000; ++i) sequence += "- [&a {id: " + std::to_string(i) + "}, *a]\n";
+  same(sequence);
+  auto numbers = yaml::load_parallel<yaml::core>(sequence, 4);
+  auto &last = numbers->as<yaml::core::sequence>()[39999]->as<yaml::core::sequence>();
+  CHECK(numbers->as<yaml::core::sequence>().size() == 40000);
+  CHECK(last[0] == last[1]);
+  CHECK(last[1]->as<yaml::core::mapping>()[0].second->as<yaml::core::integer>() == 39999);
+  CHECK(yaml::dump(*yaml::load_parallel("a: 1\n", 4)) == "a: 1\n");
+
+  // lines at the first column inside other nodes or referring to other chunks are found by the chunk parsers, the
+  // content is then loaded serially
+  auto repeat = [](std::string_view _entry) {
+    auto result = std::string{};
+    for (auto i = 0; i < 10000; ++i) {
+      result += "k" + std::to_string(i);
+      result += _entry;
+    }
+    return result;
+  };
+  auto padding = repeat(": v\n");
+  for (auto entry : { ": \"x\nb: y\"\n", ": 'x\n\nb: y'\n", ": [x,\nb]\n", ": |\n x\n\n y\n", ":\n- x\n- y\n" })
+    same(repeat(entry));
+  same(repeat(": &x v\n") + "z: *x\n");
+  same(repeat(": v\n? a\n: b\n"));
+  same("&root\n" + padding);
+  same("%YAML 1.2\n---\n" + padding);
+  same(padding + "...\n");
+  CHECK_THROWS_AS(yaml::load_parallel(padding + "---\n" + padding, 4), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load_parallel(padding + "a: [b\n" + padding, 4), yaml::parse_error);
+
+  // only parse errors fall back to the serial load, other failures of a chunk are reported
+  struct exhausting : yaml::failsafe
+  {
+    node_data make_scalar(const yaml::event &_event) const
+    {
+      if (_event.value == "boom") throw std::bad_alloc{};
+      return failsafe::make_scalar(_event);
+    }
+  };
+  CHECK_THROWS_AS(yaml::load_parallel(padding + "a: boom\n" + padding, 4, exhausting{}), std::bad_alloc);
+}
+
+TEST_CASE("Load statistics")
+{
+  auto gathered = std::vector<yaml::load_stats>{};
+  auto schema = yaml::instrumented<yaml::failsafe>{};
+  schema.on_load = [&](const yaml::load_stats &_stats) { gathered.push_back(_stats); };
+
+  auto content = std::string_view{ "a: &x [1, {b: 2}]\nc: *x\nd: *x\n" };
+  auto loaded = schema.load(content);
+  CHECK(yaml::dump(*loaded) == yaml::dump(*yaml::load(content)));
+  REQUIRE(gathered.size() == 1);
+  auto &stats = gathered.front();
+  CHECK(stats.bytes == content.size());
+  CHECK(stats.scalars == 6);
+  CHECK(stats.sequences == 1);
+  CHECK(stats.mappings == 2);
+  CHECK(stats.aliases == 2);
+  CHECK(stats.events == 14);
+  CHECK(stats.max_depth == 3);
+  CHECK(stats.alias_expansion == 10);
+  CHECK(stats.scan.count() > 0);
+  CHECK(stats.parse.count() > 0);
+  CHECK(stats.compose.count() > 0);
+  CHECK(stats.construct.count() > 0);
+  CHECK(stats.scan + stats.parse + stats.compose + stats.construct <= stats.total);
+
+  // the storage of the scanner, the parser and the composer is counted along with the arena of the document
+  auto &counting = yaml::detail::counting_resource::instance();
+  auto allocations = counting.allocations;
+  auto bytes = counting.allocated_bytes;
+  auto arena = yaml::document<yaml::failsafe::node>{ counting };
+  auto budget = yaml::default_alias_expansion;
+  arena.set_root(yaml::detail::compose_document(yaml::failsafe{}, arena, content, budget));
+  CHECK(stats.allocations > counting.allocations - allocations);
+  CHECK(stats.allocated_bytes > counting.allocated_bytes - bytes);
+
+  // the scalars are constructed while loading, the loaded values are the same
+  auto direct = yaml::load_stats{};
+  auto numbers = yaml::load<yaml::core>("[1, 2.5, true, ~, x]", direct);
+  CHECK(direct.scalars == 5);
+  CHECK(direct.construct.count() > 0);
+  auto items = numbers->as<yaml::core::sequence>();
+  CHECK(std::get<yaml::core::integer>(items[0]->data) == 1);
+  CHECK(std::get<yaml::core::floating>(items[1]->data) == 2.5);
+  CHECK(std::get<yaml::core::scalar>(items[4]->data) == "x");
+  CHECK(gathered.size() == 1);
+
+  // every document of a stream is reported
+  auto input = std::istringstream{ "a\n---\n[b]\n---\n" };
+  auto core = yaml::instrumented<yaml::core>{};
+  core.on_load = schema.on_load;
+  auto documents = yaml::stream{ input, 16, core };
+  auto count = std::ranges::distance(documents);
+  CHECK(count == 3);
+  REQUIRE(gathered.size() == 4);
+  CHECK(gathered[1].scalars == 1);
+  CHECK(gathered[2].sequences == 1);
+  CHECK(gathered[2].max_depth == 1);
+  CHECK(gathered[3].events == 1);
+}
+
+TEST_CASE("Encodings")
+{
+  using namespace std::literals;
+  using yaml::encoding;
+  CHECK(yaml::detect_encoding("\x00\x00\xFE\xFF"sv) == encoding::utf32_be);
+  CHECK(yaml::detect_encoding("\x00\x00\x00" "a"sv) == encoding::utf32_be);
+  CHECK(yaml::detect_encoding("\xFF\xFE\x00\x00"sv) == encoding::utf32_le);
+  CHECK(yaml::detect_encoding("a\x00\x00\x00"sv) == encoding::utf32_le);
+  CHECK(yaml::detect_encoding("\xFE\xFF" "a"sv) == encoding::utf16_be);
+  CHECK(yaml::detect_encoding("\x00" "a"sv) == encoding::utf16_be);
+  CHECK(yaml::detect_encoding("\xFF\xFE" "a\x00"sv) == encoding::utf16_le);
+  CHECK(yaml::detect_encoding("a\x00" "b\x00"sv) == encoding::utf16_le);
+  CHECK(yaml::detect_encoding("\xEF\xBB\xBF" "a"sv) == encoding::utf8);
+  CHECK(yaml::detect_encoding("a: b"sv) == encoding::utf8);
+  CHECK(yaml::detect_encoding(""sv) == encoding::utf8);
+
+  // every kernel of the running cpu agrees with the scalar validator, whatever the position of the sequences in the
+  // vectors
+  // five valid sequences then ill formed ones
+  auto pieces = std::vector<std::string>{ "a", "\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xF4\x8F\xBF\xBF",
+    "\x80", "\xC0\xAF", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xF8\x88\x80\x80\x80", "\xC3",
+    "\xE2\x82", "\xF0\x9F\x98", "\xFF" };
+  auto text = std::string{};
+  for (auto i = std::size_t{ 0 }; i < 4000; ++i) {
+    text += std::string(i % 37, 'x');
+    text += pieces[(i * 7) % 5];
+    if (i % 41 == 0) text += pieces[5 + i / 41 % (pieces.size() - 5)];
+  }
+  for (auto &kernels : yaml::detail::simd::unicode_available())
+    for (auto start = std::size_t{ 0 }; start < text.size(); start += 97) {
+      auto part = std::string_view{ text }.substr(start, 200);
+      CHECK(kernels.validate(part.data(), part.size())
+            == (yaml::detail::find_invalid_utf8(part.data(), part.size()) == part.size()));
+    }
+  CHECK(yaml::is_utf8("a: \xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\n"));
+  CHECK_FALSE(yaml::is_utf8(std::string(100, 'a') + "\xE2\x82"));
+
+  // utf-16 and utf-32 content is transcoded with its byte order mark
+  auto content = std::string{ "\xEF\xBB\xBF" };
+  for (auto i = 0; i < 50; ++i)
+    content += "key" + std::to_string(i) + ": [caf\xC3\xA9, \xE2\x82\xAC, \xF0\x9F\x98\x80]\n";
+  for (auto width : { 2, 4 })
+    for (auto big_endian : { false, true }) {
+      auto encoded = encode(content, static_cast<std::size_t>(width), big_endian);
+      CHECK(yaml::to_utf8(encoded) == content);
+      CHECK(yaml::to_utf8(encoded.substr(static_cast<std::size_t>(width))) == content.substr(3));
+      CHECK(yaml::dump(*yaml::load(encoded)) == yaml::dump(*yaml::load(content)));
+    }
+  auto utf16 = encode(content, 2, false);
+  CHECK(str(at(at(*yaml::load(utf16), "key49"), 2)) == "\xF0\x9F\x98\x80");
+  CHECK(yaml::load<yaml::tape_schema>(utf16).root()["key3"][0].scalar() == "caf\xC3\xA9");
+  CHECK(yaml::load<yaml::ondemand>(utf16).root()["key7"][1].scalar() == "\xE2\x82\xAC");
+  CHECK(yaml::load_into<std::map<std::string, std::vector<std::string>>>(utf16).size() == 50);
+  auto events = std::size_t{ 0 };
+  yaml::parse(utf16, [&](const yaml::event &) { ++events; });
+  CHECK(events == 306);
+  auto stream = yaml::load_all_parallel(encode("a\n---\nb\n", 2, true), 2);
+  REQUIRE(stream.size() == 2);
+  CHECK(str(*stream[1]) == "b");
+
+  // ill formed content is located in the utf-8 text
+  auto invalid = [](std::string_view _content, std::size_t _line, std::size_t _column) {
+    try {
+      yaml::load(_content);
+      FAIL("expected a parse error");
+    } catch (const yaml::parse_error &_error) {
+      CHECK(_error.where().line == _line);
+      CHECK(_error.where().column == _column);
+    }
+  };
+  invalid("a: b\nc: \xED\xA0\x80\n", 1, 3);
+  invalid("a: \xC3\xA9\xC3", 0, 5);
+  invalid(encode("a: b\n", 2, false) + "\x00\xD8" "a\x00"s, 1, 0);
+  invalid(encode("a", 4, true) + "\x00\x11\x00\x00"s, 0, 1);
+  invalid(encode("ab", 2, false) + "c", 0, 2);
+  CHECK_THROWS_AS(yaml::load<yaml::tape_schema>("\xFF"), yaml::parse_error);
+  CHECK_THROWS_AS(yaml::load_into<std::string>("\xC0\xAF"), yaml::parse_error);
+}
+
+TEST_CASE("Reusable parser")
+{
+  auto parser = yaml::parser{};
+  auto payload =
+    std::string{ "id: &id 42\nmethod: !!str \"get\\tuser\"\nargs: [*id, 'it''s', {deep: [1, 2]}]\ntext: |\n  two\n  lines\n" };
+  auto &first = parser.load(payload);
+  auto &second = parser.load("- a\n- b\n");
+  auto &empty = parser.load("");
+  // the documents loaded stay valid until the reset
+  CHECK(str(at(first, "method")) == "get\tuser");
+  CHECK(str(at(at(first, "args"), 0)) == "42");
+  CHECK(str(at(at(first, "args"), 1)) == "it's");
+  CHECK(str(at(first, "text")) == "two\nlines\n");
+  CHECK(str(at(second, 1)) == "b");
+  CHECK(str(empty).empty());
+  CHECK(yaml::dump(first) == yaml::dump(*yaml::load(payload)));
+
+  // an ill formed load leaves the parser ready for the next one, anchors do not leak from one document to another
+  CHECK_THROWS_AS(parser.load("a: [b"), yaml::parse_error);
+  CHECK_THROWS_AS(parser.load("a: *id"), yaml::parse_error);
+  CHECK_THROWS_AS(parser.load("a: b\n---\nc\n"), yaml::parse_error);
+  CHECK(str(at(parser.load("a: b"), "a")) == "b");
+
+  // memory is recycled: once warmed up the parser keeps the same blocks whatever the number of loads
+  for (auto i = 0; i < 3; ++i) {
+    parser.reset();
+    for (auto j = 0; j < 100; ++j) parser.load(payload);
+  }
+  auto capacity = parser.capacity();
+  for (auto i = 0; i < 10; ++i) {
+    parser.reset();
+    for (auto j = 0; j < 100; ++j) CHECK(str(at(parser.load(payload), "method")) == "get\tuser");
+  }
+  CHECK(parser.capacity() == capacity);
+
+  // other schemas and encodings
+  auto core = yaml::parser<yaml::core>{ yaml::core{ .max_alias_expansion = 2 } };
+  CHECK(core.load("a: 1\n").as<yaml::core::mapping>()[0].second->as<yaml::core::integer>() == 1);
+  CHECK_THROWS_AS(core.load("a: &a [1]\nb: [*a, *a, *a]\n"), yaml::parse_error);
+  CHECK(core.load(encode("[x]", 2, true)).as<yaml::core::sequence>().size() == 1);
+}
+
+TEST_CASE("Feed parser")
+{
+  // the events and the documents of the stream are the same whatever the chunks it arrives in, chunks ending inside
+  // tokens, line breaks, markers and multi-byte characters
+  auto documents = std::vector<std::string>{
+    "\xEF\xBB\xBF# comment\r\nkey: \"quoted\\tvalue\n  folded \\u00e9\"\r\nblock: |\n  caf\xC3\xA9\n  --- indented\n"
+    "flow: [a, 'b''c', {d: e}]\n",
+    "--- !!str tagged\n...\n",
+    "%YAML 1.2\n---\n- &a anchored\n- *a\n- >\n  folded\n  text\n",
+    "--- [last, {1: 2}]",
+  };
+  auto content = std::string{};
+  auto expected = std::vector<std::string>{};
+  for (auto &document : documents) {
+    content += document;
+    expected.push_back(yaml::dump(*yaml::load(document)));
+  }
+  auto events = std::vector<std::string>{};
+  yaml::parse(content, [&](const yaml::event &_event) { events.push_back(located(_event)); });
+  auto fed = [](auto _feed) {
+    auto result = std::vector<std::string>{};
+    auto parser = yaml::feed_parser{ [&](yaml::document<yaml::failsafe::node> _document) {
+      result.push_back(yaml::dump(*_document));
+    } };
+    _feed(parser);
+    parser.finish();
+    return result;
+  };
+  auto streamed = [](auto _feed) {
+    auto result = std::vector<std::string>{};
+    auto parser = yaml::feed_parser{ [&](const yaml::event &_event) { result.push_back(located(_event)); } };
+    _feed(parser);
+    parser.finish();
+    return result;
+  };
+  auto text = std::string_view{ content };
+  for (auto split = std::size_t{ 0 }; split <= text.size(); ++split) {
+    auto halves = [&](auto &_parser) {
+      _parser.feed(text.substr(0, split));
+      _parser.feed(text.substr(split));
+    };
+    CHECK(fed(halves) == expected);
+    CHECK(streamed(halves) == events);
+  }
+  for (auto size = std::size_t{ 1 }; size <= 17; ++size) {
+    auto chunks = [&](auto &_parser) {
+      for (auto at = std::size_t{ 0 }; at < text.size(); at += size) _parser.feed(text.substr(at, size));
+    };
+    CHECK(fed(chunks) == expected);
+    CHECK(streamed(chunks) == events);
+  }
+
+  // the events are handed over as soon as the lines they depend on are received, the tokens close to the end of the
+  // lines received wait for the next ones
+  auto early = std::vector<std::string>{};
+  auto incremental = yaml::feed_parser{ [&](const yaml::event &_event) { early.push_back(summary(_event)); } };
+  auto sequence = event_summary("- a\n- b\n- c\n- d\n");
+  incremental.feed(std::string_view{ "- a\n- b\n- c\n- d" });
+  CHECK(early == std::vector<std::string>(sequence.begin(), sequence.begin() + 5));
+  incremental.feed(std::string_view{ "\n" });
+  CHECK(early == std::vector<std::string>(sequence.begin(), sequence.begin() + 6));
+  incremental.finish();
+  CHECK(early == sequence);
+
+  // documents are handed over as soon as the marker ending them is received
+  auto count = std::size_t{ 0 };
+  auto parser = yaml::feed_parser{ [&](yaml::document<yaml::failsafe::node>) { ++count; } };
+  // the line of the marker is complete once its line break is received
+  auto second = content.find("--- !!str");
+  auto third = content.find("%YAML");
+  parser.feed(text.substr(0, second + 3));
+  CHECK(count == 0);
+  parser.feed(text.substr(second + 3, third - second - 3));
+  CHECK(count == 2);
+  // the marker of the last document waits for its line break
+  parser.feed(text.substr(third));
+  CHECK(count == 2);
+  parser.finish();
+  CHECK(count == 4);
+
+  // an ill formed document throws from the feed completing it, the following documents are still loaded
+  auto loaded = std::vector<std::string>{};
+  auto failing = yaml::feed_parser{ [&](yaml::document<yaml::failsafe::node> _document) {
+    loaded.emplace_back(str(*_document));
+  } };
+  failing.feed(std::string_view{ "--- a\n--- [b\n" });
+  try {
+    failing.feed(std::string_view{ "--- c\n" });
+    FAIL("the second document is ill formed");
+  } catch (const yaml::parse_error &_error) {
+    CHECK(_error.where().line == 2);
+  }
+  failing.feed(std::string_view{ "--- d\n" });
+  failing.finish();
+  CHECK(loaded == std::vector<std::string>{ "a", "c", "d" });
+
+  // an error found before the document is complete throws right away, the rest of the document is skipped
+  loaded.clear();
+  auto skipping = yaml::feed_parser{ [&](yaml::document<yaml::failsafe::node> _document) {
+    loaded.emplace_back(str(*_document));
+  } };
+  CHECK_THROWS_AS(skipping.feed(std::string_view{ "- a\n- b: c: d\n- e\n" }), yaml::parse_error);
+  skipping.feed(std::string_view{ "- f\n--- g\n" });
+  skipping.finish();
+  CHECK(loaded == std::vector<std::string>{ "g" });
+
+  // utf-16 and utf-32 input is transcoded chunk by chunk into the same documents
+  for (auto width : { 2, 4 }) {
+    auto encoded = encode(content, static_cast<std::size_t>(width), width == 4);
+    auto wide = std::string_view{ encoded };
+    for (auto size = std::size_t{ 1 }; size <= 9; ++size)
+      CHECK(fed([&](auto &_parser) {
+        for (auto at = std::size_t{ 0 }; at < wide.size(); at += size) _parser.feed(wide.substr(at, size));
+      }) == expected);
+  }
+}
@@ -0,0 +1,346 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <yaml/core.hpp>
+#include <yaml/detail/parser.hpp>
+#include <yaml/encoding.hpp>
+#include <yaml/error.hpp>
+#include <yaml/event.hpp>
+
+namespace yaml {
+
+// a member bound to the value of a mapping key
+template<typename Class, typename Member> struct field
+{
+  std::string_view key;
+  Member Class::*member;
+};
+
+// a type loaded from a mapping lists its members with a static constexpr yaml_fields() returning a tuple of fields:
+//   static constexpr auto yaml_fields() { return std::tuple{ yaml::field{ "sku", &product::sku }, ... }; }
+template<typename T>
+concept described = requires { std::tuple_size<decltype(T::yaml_fields())>::value; };
+
+namespace detail {
+
+  template<typename T> inline constexpr bool is_optional = false;
+  template<typename T> inline constexpr bool is_optional<std::optional<T>> = true;
+  template<typename T> inline constexpr bool is_vector = false;
+  template<typename T, typename Allocator> inline constexpr bool is_vector<std::vector<T, Allocator>> = true;
+
+  // maps keyed by strings such as std::map<std::string, T>
+  template<typename T>
+  concept string_map = std::same_as<typename T::key_type, std::string>
+                       && requires(T _map, std::string _key) { _map[std::move(_key)]; };
+
+  constexpr std::uint64_t key_hash(std::string_view _key, std::uint64_t _seed) noexcept
+  {
+    auto hash = 0xcbf29ce484222325ull ^ (_seed * 0x9e3779b97f4a7c15ull);
+    for (auto c : _key) hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+    return hash ^ (hash >> 29);
+  }
+
+  // perfect hash of the keys of a described type: the smallest power of two table and the seed placing every key in
+  // its own slot are searched at compile time, a lookup hashes the key once and compares a single candidate
+  template<described T> class key_table
+  {
+  public:
+    static constexpr auto fields = T::yaml_fields();
+    static constexpr auto count = std::tuple_size_v<decltype(fields)>;
+
+    // position of the key in the fields, count when the type has no such key
+    static constexpr std::size_t find(std::string_view _key) noexcept
+    {
+      auto slot = slots[key_hash(_key, shape.seed) & shape.mask];
+      return slot < count && keys[slot] == _key ? slot : count;
+    }
+
+  private:
+    struct layout
+    {
+      std::uint64_t seed;
+      std::uint64_t mask;
+    };
+
+    static constexpr auto keys = std::apply(
+      [](auto... _fields) { return std::array<std::string_view, count>{ _fields.key... }; }, fields);
+
+    static constexpr layout search()
+    {
+      for (auto i = std::size_t{ 0 }; i < count; ++i)
+        for (auto j = i + 1; j < count; ++j)
+          if (keys[i] == keys[j]) throw std::logic_error("duplicate key in yaml_fields");
+      for (auto size = std::bit_ceil(std::max<std::size_t>(count, 1));; size *= 2)
+        for (auto seed = std::uint64_t{ 0 }; seed < 64; ++seed) {
+          auto distinct = true;
+          for (auto i = std::size_t{ 0 }; distinct && i < count; ++i)
+            for (auto j = i + 1; distinct && j < count; ++j)
+              distinct = ((key_hash(keys[i], seed) ^ key_hash(keys[j], seed)) & (size - 1)) != 0;
+          if (distinct) return layout{ seed, size - 1 };
+        }
+    }
+
+    static constexpr auto shape = search();
+
+    static constexpr auto slots = [] {
+      auto result = std::array<std::size_t, shape.mask + 1>{};
+      result.fill(count);
+      for (auto i = std::size_t{ 0 }; i < count; ++i) result[key_hash(keys[i], shape.seed) & shape.mask] = i;
+      return result;
+    }();
+  };
+
+  // fills values straight from the events of a single document, no tree is built. aliases replay the events recorded
+  // for their anchor, the number of nodes replayed is bounded by _alias_limit like when composing a tree
+  class binder
+  {
+  public:
+    binder(std::string_view _content, std::size_t _alias_limit)
+      : pool(arena), events(decode(_content, pool), pool), alias_limit(_alias_limit)
+    {}
+
+    // an empty stream leaves the value untouched
+    template<typename T> void load(T &_value)
+    {
+      events.next();
+      if (events.peek().type == event_type::stream_end) return;
+      events.next();
+      read(_value);
+      events.next();
+      if (events.peek().type != event_type::stream_end)
+        throw parse_error("expected a single document in the stream", events.peek().start);
+    }
+
+  private:
+    // events of an anchored node with aliases expanded
+    struct anchored
+    {
+      std::vector<event> events;
+      std::size_t size = 0;// nodes of the recording
+    };
+
+    struct recording
+    {
+      std::string_view anchor;
+      anchored content;
+      std::size_t depth = 0;
+    };
+
+    struct replay
+    {
+      const anchored *source;
+      std::size_t at;
+    };
+
+    std::pmr::monotonic_buffer_resource arena;
+    string_pool pool;
+    parser events;
+    std::size_t alias_limit;
+    std::size_t expanded = 0;
+    std::vector<recording> recordings;
+    std::vector<replay> replays;
+    std::unordered_map<std::string_view, anchored> anchors;
+
+    template<typename T> void read(T &_value)
+    {
+      if constexpr (described<T>)
+        read_fields(_value);
+      else if constexpr (std::same_as<T, std::string>)
+        _value = scalar("expected a string").value;
+      else if constexpr (std::same_as<T, bool>)
+        _value = convert<core::boolean>(scalar("expected a boolean"), "expected a boolean");
+      else if constexpr (std::integral<T>) {
+        auto value = scalar("expected an integer");
+        auto number = convert<core::integer>(value, "expected an integer");
+        if (!std::in_range<T>(number)) throw parse_error("integer out of range", value.start);
+        _value = static_cast<T>(number);
+      } else if constexpr (std::floating_point<T>) {
+        auto value = scalar("expected a number");
+        auto data = resolve(value);
+        if (auto *number = std::get_if<core::integer>(&data))
+          _value = static_cast<T>(*number);
+        else if (auto *number = std::get_if<core::floating>(&data))
+          _value = static_cast<T>(*number);
+        else
+          throw parse_error("expected a number", value.start);
+      } else if constexpr (is_optional<T>) {
+        if (peek().type == event_type::scalar && std::holds_alternative<core::null>(resolve(peek()))) {
+          next();
+          _value.reset();
+        } else
+          read(_value.emplace());
+      } else if constexpr (is_vector<T>) {
+        expect(event_type::sequence_start, "expected a sequence");
+        _value.clear();
+        while (peek().type != event_type::sequence_end) read(_value.emplace_back());
+        next();
+      } else if constexpr (string_map<T>) {
+        expect(event_type::mapping_start, "expected a mapping");
+        while (peek().type != event_type::mapping_end) read(_value[std::string{ scalar("expected a scalar key").value }]);
+        next();
+      } else
+        static_assert(sizeof(T) == 0, "type cannot be loaded, describe it with yaml_fields()");
+    }
+
+    template<typename T> void read_fields(T &_value)
+    {
+      using table = key_table<T>;
+      expect(event_type::mapping_start, "expected a mapping");
+      while (peek().type != event_type::mapping_end) {
+        if (peek().type != event_type::scalar) {
+          skip();
+          skip();
+          continue;
+        }
+        auto position = table::find(next().value);
+        if (position == table::count) {
+          skip();
+          continue;
+        }
+        [&]<std::size_t... Index>(std::index_sequence<Index...>) {
+          (void)((Index == position && (read(_value.*std::get<Index>(table::fields).member), true)) || ...);
+        }(std::make_index_sequence<table::count>{});
+      }
+      next();
+    }
+
+    static core::node_data resolve(const event &_scalar)
+    {
+      try {
+        return core::convert(core::pending{ _scalar.value, resolution_of(_scalar) });
+      } catch (const std::invalid_argument &_error) {
+        throw parse_error(_error.what(), _scalar.start);
+      }
+    }
+
+    template<typename Type> static Type convert(const event &_scalar, std::string_view _problem)
+    {
+      auto data = resolve(_scalar);
+      if (auto *value = std::get_if<Type>(&data)) return *value;
+      throw parse_error(_problem, _scalar.start);
+    }
+
+    event scalar(std::string_view _problem)
+    {
+      auto result = next();
+      if (result.type != event_type::scalar) throw parse_error(_problem, result.start);
+      return result;
+    }
+
+    void expect(event_type _type, std::string_view _problem)
+    {
+      if (auto result = next(); result.type != _type) throw parse_error(_problem, result.start);
+    }
+
+    // consumes the next node with its whole content
+    void skip()
+    {
+      auto depth = std::size_t{ 0 };
+      do {
+        auto type = next().type;
+        if (type == event_type::sequence_start || type == event_type::mapping_start)
+          ++depth;
+        else if (type == event_type::sequence_end || type == event_type::mapping_end)
+          --depth;
+      } while (depth);
+    }
+
+    // the next event, aliases are replaced by the events of their anchor
+    const event &peek()
+    {
+      for (;;) {
+        auto &upcoming = replays.empty() ? events.peek() : replays.back().source->events[replays.back().at];
+        if (upcoming.type != event_type::alias) return upcoming;
+        auto alias = upcoming;
+        advance();
+        auto found = anchors.find(alias.anchor);
+        if (found == anchors.end()) throw parse_error("found undefined alias", alias.start);
+        expanded += found->second.size;
+        if (expanded > alias_limit) throw parse_error("aliases expand beyond the configured limit", alias.start);
+        replays.push_back(replay{ &found->second, 0 });
+      }
+    }
+
+    event next()
+    {
+      auto result = peek();
+      auto replaying = !replays.empty();
+      advance();
+      for (auto &active : recordings) {
+        active.content.events.push_back(result);
+        track(active, result.type);
+      }
+      // anchors met while replaying were already recorded when first read
+      if (!replaying && !result.anchor.empty()) {
+        recordings.push_back(recording{ result.anchor, anchored{ { result }, 0 }, 0 });
+        track(recordings.back(), result.type);
+      }
+      while (!recordings.empty() && recordings.back().depth == 0) {
+        anchors[recordings.back().anchor] = std::move(recordings.back().content);
+        recordings.pop_back();
+      }
+      return result;
+    }
+
+    // the finished replays are dropped right away so a redefined anchor never replaces a replay in progress
+    void advance()
+    {
+      if (replays.empty())
+        events.next();
+      else
+        ++replays.back().at;
+      while (!replays.empty() && replays.back().at == replays.back().source->events.size()) replays.pop_back();
+    }
+
+    static void track(recording &_recording, event_type _type) noexcept
+    {
+      switch (_type) {
+      case event_type::scalar: ++_recording.content.size; break;
+      case event_type::sequence_start:
+      case event_type::mapping_start:
+        ++_recording.content.size;
+        ++_recording.depth;
+        break;
+      case event_type::sequence_end:
+      case event_type::mapping_end: --_recording.depth; break;
+      default: break;
+      }
+    }
+  };
+
+}// namespace detail
+
+// schema loading a document straight into a T: described types are read from mappings, std::vector from sequences,
+// std::optional is empty for null, maps keyed by std::string take every key. scalars follow the core schema, a
+// std::string member takes the content of any scalar. unknown keys are skipped and missing keys keep their default.
+template<typename T> struct bound
+{
+  // nodes loading may visit through aliases, beyond it loading fails
+  std::size_t max_alias_expansion = default_alias_expansion;
+
+  T load(std::string_view _content) const
+  {
+    auto result = T{};
+    detail::binder{ _content, max_alias_expansion }.load(result);
+    return result;
+  }
+};
+
+template<typename T> T load_into(std::string_view _content) { return bound<T>{}.load(_content); }
+
+}// namespace yaml
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <variant>
+
+#include <yaml/detail/composer.hpp>
+#include <yaml/document.hpp>
+#include <yaml/error.hpp>
+#include <yaml/event.hpp>
+
+namespace yaml {
+namespace detail {
+
+  // scalar content matched by hand written automatons following the resolution tables of the spec
+  constexpr bool is_octal(char _c) { return _c >= '0' && _c <= '7'; }
+
+  // core: [-+]? [0-9]+
+  constexpr bool is_core_decimal(std::string_view _s)
+  {
+    if (!_s.empty() && (_s.front() == '-' || _s.front() == '+')) _s.remove_prefix(1);
+    if (_s.empty()) return false;
+    for (auto c : _s)
+      if (!is_digit(c)) return false;
+    return true;
+  }
+
+  // json: -? ( 0 | [1-9] [0-9]* )
+  constexpr bool is_json_integer(std::string_view _s)
+  {
+    if (!_s.empty() && _s.front() == '-') _s.remove_prefix(1);
+    if (_s.empty() || (_s.front() == '0' && _s.size() > 1)) return false;
+    for (auto c : _s)
+      if (!is_digit(c)) return false;
+    return true;
+  }
+
+  // core: [-+]? ( \. [0-9]+ | [0-9]+ ( \. [0-9]* )? ) ( [eE] [-+]? [0-9]+ )?
+  // json: -? ( 0 | [1-9] [0-9]* ) ( \. [0-9]* )? ( [eE] [-+]? [0-9]+ )?
+  template<bool Json> constexpr bool is_number(std::string_view _s)
+  {
+    auto at = std::size_t{ 0 };
+    auto digits = [&] {
+      auto first = at;
+      while (at < _s.size() && is_digit(_s[at])) ++at;
+      return at - first;
+    };
+    if (at < _s.size() && (_s[at] == '-' || (!Json && _s[at] == '+'))) ++at;
+    auto integral_at = at;
+    auto integral = digits();
+    if (Json && (integral == 0 || (integral > 1 && _s[integral_at] == '0'))) return false;
+    if (at < _s.size() && _s[at] == '.') {
+      ++at;
+      auto fraction = digits();
+      if (!Json && integral == 0 && fraction == 0) return false;
+    } else if (integral == 0)
+      return false;
+    if (at < _s.size() && (_s[at] == 'e' || _s[at] == 'E')) {
+      ++at;
+      if (at < _s.size() && (_s[at] == '-' || _s[at] == '+')) ++at;
+      if (digits() == 0) return false;
+    }
+    return at == _s.size();
+  }
+
+  // whether a number out of the range of double is too large rather than too small: the place of its first significant
+  // digit from the decimal point, moved by the exponent, tells
+  constexpr bool is_too_large(std::string_view _s)
+  {
+    auto exponent_at = std::min(_s.find_first_of("eE"), _s.size());
+    auto mantissa = _s.substr(0, exponent_at);
+    auto point = std::min(mantissa.find('.'), mantissa.size());
+    auto first = mantissa.find_first_of("123456789");
+    if (first == std::string_view::npos) return false;
+    // exponents beyond the range of double are saturated
+    auto limit = std::int64_t{ 1'000'000 };
+    auto exponent = std::int64_t{ 0 };
+    auto digits = _s.substr(std::min(exponent_at + 1, _s.size()));
+    auto negative = digits.starts_with('-');
+    if (negative || digits.starts_with('+')) digits.remove_prefix(1);
+    for (auto c : digits) exponent = std::min(exponent * 10 + (c - '0'), limit);
+    auto place = first < point ? static_cast<std::int64_t>(point - first) : -static_cast<std::int64_t>(first - point - 1);
+    return place + (negative ? -exponent : exponent) > 0;
+  }
+
+  inline double to_double(std::string_view _s)
+  {
+    if (!_s.empty() && _s.front() == '+') _s.remove_prefix(1);
+    auto result = 0.0;
+    auto [end, error] = std::from_chars(_s.data(), _s.data() + _s.size(), result);
+    // too large numbers are infinite, too small ones are zeros keeping their sign
+    if (error == std::errc::result_out_of_range)
+      result = is_too_large(_s) ? std::numeric_limits<double>::infinity() : 0.0;
+    return error == std::errc::result_out_of_range && _s.front() == '-' ? -result : result;
+  }
+
+  // nearest double of digits in _base, for the integers too large for std::int64_t
+  inline double to_double(std::string_view _digits, int _base)
+  {
+    auto result = 0.0;
+    for (auto c : _digits) result = result * _base + (is_digit(c) ? c - '0' : (c | 0x20) - 'a' + 10);
+    return result;
+  }
+
+  // false when the value does not fit
+  inline bool to_integer(std::string_view _s, int _base, std::int64_t &_result)
+  {
+    if (!_s.empty() && _s.front() == '+') _s.remove_prefix(1);
+    auto [end, error] = std::from_chars(_s.data(), _s.data() + _s.size(), _result, _base);
+    return error == std::errc{} && end == _s.data() + _s.size();
+  }
+
+  // how a scalar is resolved once read: from its plain content or from its tag. quoted and ! tagged scalars are
+  // strings, unknown tags are kept as strings
+  enum class resolution : std::uint8_t { plain, string, null, boolean, integer, floating };
+
+  inline resolution resolution_of(const event &_event)
+  {
+    // the non-specific ! tag makes the scalar a string even though the parser reports it as implicit
+    if (_event.tag == "!") return resolution::string;
+    if (_event.implicit) return resolution::plain;
+    constexpr auto prefix = std::string_view{ "tag:yaml.org,2002:" };
+    if (!_event.tag.starts_with(prefix)) return resolution::string;
+    auto name = _event.tag.substr(prefix.size());
+    if (name == "null") return resolution::null;
+    if (name == "bool") return resolution::boolean;
+    if (name == "int") return resolution::integer;
+    if (name == "float") return resolution::floating;
+    return resolution::string;
+  }
+
+  // schemas resolving scalars to native values, the json schema only accepts the json forms of plain scalars
+  template<bool Json> struct native_schema
+  {
+    struct node;
+    using node_ref = node *;
+    using null = std::nullptr_t;
+    using boolean = bool;
+    using integer = std::int64_t;
+    using floating = double;
+    // plain and single line scalars are views of the loaded content, the caller keeps it alive
+    using scalar = std::string_view;
+    using sequence = std::span<node_ref>;
+    using mapping = std::span<std::pair<node_ref, node_ref>>;
+
+    // a scalar read from the stream and not converted yet
+    struct pending
+    {
+      std::string_view value;
+      resolution kind;
+    };
+
+    using node_data = std::variant<pending, null, boolean, integer, floating, scalar, sequence, mapping>;
+
+    // untagged scalars are converted the first time they are inspected, the conversion writes the node so a tree
+    // shared between threads should be resolved beforehand
+    struct node
+    {
+      node() = default;
+      node(node_data &&_data) : data(std::move(_data)) {}
+
+      template<typename Type> const Type &as() const
+      {
+        resolve();
+        return std::get<Type>(data);
+      }
+      template<typename Type> const Type *try_as() const
+      {
+        resolve();
+        return std::get_if<Type>(&data);
+      }
+      template<typename Type> bool is() const
+      {
+        resolve();
+        return std::holds_alternative<Type>(data);
+      }
+
+      void resolve() const
+      {
+        if (auto *scalar = std::get_if<pending>(&data)) data = convert(*scalar);
+      }
+
+      mutable node_data data;
+    };
+
+    // nodes a full traversal may visit through aliases, beyond it loading fails
+    std::size_t max_alias_expansion = default_alias_expansion;
+
+    decltype(auto) get_node(this auto &&_self, node_ref _node) { return *_node; }
+
+    // scalars tagged with a type are converted while loading so that a value not matching its tag fails the load, so
+    // do json plain scalars of no json form. the other scalars are converted when inspected
+    node_data make_scalar(const event &_event) const
+    {
+      auto kind = resolution_of(_event);
+      if constexpr (Json)
+        if (kind == resolution::plain && !is_json_form(_event.value))
+          throw parse_error("plain scalar matches no json type", _event.start);
+      if (kind == resolution::plain || kind == resolution::string) return pending{ _event.value, kind };
+      try {
+        return convert(pending{ _event.value, kind });
+      } catch (const std::invalid_argument &_error) {
+        throw parse_error(_error.what(), _event.start);
+      }
+    }
+
+    // loads the single document of the stream, an empty stream is loaded as null
+    document<node> load(std::string_view _content) const
+    {
+      return compose_single(*this, _content, max_alias_expansion);
+    }
+
+    static node_data convert(pending _scalar)
+    {
+      auto value = _scalar.value;
+      switch (_scalar.kind) {
+      case resolution::plain: return classify(value);
+      case resolution::string: return scalar{ value };
+      case resolution::null:
+        if (auto result = classify(value); std::holds_alternative<null>(result)) return result;
+        break;
+      case resolution::boolean:
+        if (auto result = classify(value); std::holds_alternative<boolean>(result)) return result;
+        break;
+      case resolution::integer:
+        if (auto result = classify(value); std::holds_alternative<integer>(result)) return result;
+        break;
+      case resolution::floating: {
+        auto result = classify(value);
+        if (auto *number = std::get_if<integer>(&result)) return static_cast<floating>(*number);
+        if (std::holds_alternative<floating>(result)) return result;
+        break;
+      }
+      }
+      throw std::invalid_argument("scalar does not match its tag: " + std::string{ value });
+    }
+
+    // the json forms of plain scalars, empty nodes are null like in the core schema
+    static constexpr bool is_json_form(std::string_view _value)
+    {
+      return _value.empty() || _value == "null" || _value == "true" || _value == "false" || is_json_integer(_value)
+             || is_number<true>(_value);
+    }
+
+    static node_data classify(std::string_view _value)
+    {
+      if constexpr (Json) {
+        if (_value.empty() || _value == "null") return null{};
+        if (_value == "true") return true;
+        if (_value == "false") return false;
+        auto number = std::int64_t{};
+        if (is_json_integer(_value) && to_integer(_value, 10, number)) return number;
+        if (is_number<true>(_value)) return to_double(_value);
+        throw std::invalid_argument("plain scalar matches no json type: " + std::string{ _value });
+      } else {
+        if (_value.empty()) return null{};
+        switch (_value.front()) {
+        case '~':
+        case 'n':
+        case 'N':
+          if (_value == "~" || _value == "null" || _value == "Null" || _value == "NULL") return null{};
+          break;
+        case 't':
+        case 'T':
+          if (_value == "true" || _value == "True" || _value == "TRUE") return true;
+          break;
+        case 'f':
+        case 'F':
+          if (_value == "false" || _value == "False" || _value == "FALSE") return false;
+          break;
+        case '.':
+          if (_value == ".nan" || _value == ".NaN" || _value == ".NAN") return std::numeric_limits<double>::quiet_NaN();
+          break;
+        default: break;
+        }
+
+        // integers out of the range of std::int64_t are floats whatever their base, like decimal ones matching the
+        // float form too. a !!int tag then rejects them
+        auto number = std::int64_t{};
+        if (_value.size() > 2 && _value[0] == '0' && (_value[1] == 'o' || _value[1] == 'x')) {
+          auto digits = _value.substr(2);
+          auto base = _value[1] == 'o' ? 8 : 16;
+          for (auto c : digits)
+            if (base == 8 ? !is_octal(c) : !is_hex(c)) return scalar{ _value };
+          if (to_integer(digits, base, number)) return number;
+          return to_double(digits, base);
+        }
+        if (is_core_decimal(_value) && to_integer(_value, 10, number)) return number;
+        if (is_number<false>(_value)) return to_double(_value);
+
+        auto magnitude = _value;
+        if (magnitude.front() == '-' || magnitude.front() == '+') magnitude.remove_prefix(1);
+        if (magnitude == ".inf" || magnitude == ".Inf" || magnitude == ".INF")
+          return _value.front() == '-' ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+        return scalar{ _value };
+      }
+    }
+  };
+
+}// namespace detail
+
+// tags of the core schema, plain scalars matching none of the null, bool, int and float forms are strings
+using core = detail::native_schema<false>;
+// tags of the json schema, plain scalars must have one of the json forms
+using json = detail::native_schema<true>;
+
+}// namespace yaml
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <yaml/detail/parser.hpp>
+#include <yaml/document.hpp>
+#include <yaml/encoding.hpp>
+#include <yaml/error.hpp>
+#include <yaml/event.hpp>
+#include <yaml/stats.hpp>
+
+namespace yaml::detail {
+
+// builds the tree of a single document from its events without recursion. children are gathered on a scratch stack
+// shared by every level and copied once into the arena when their collection ends, so each collection costs a single
+// exact-size allocation.
+// aliases share the anchored node. the number of nodes a full traversal would visit through aliases is accumulated and
+// bounded by _alias_limit, so exponential alias chains are rejected as soon as they exceed it.
+// the schema provides the node layout and turns scalar events into node data through make_scalar. schemas gathering
+// stats have every event counted and the construction of the scalars timed, the others pay nothing for it. the stacks
+// and the anchor table take their storage from _resource, a composer restarted for each document of a reusable parser
+// recycles it.
+template<typename Schema> class composer
+{
+public:
+  using node = typename Schema::node;
+  using node_ref = node *;
+
+  composer(const Schema &_schema, document<node> &_document, std::size_t _alias_limit, load_stats *_stats = nullptr,
+    std::pmr::memory_resource *_resource = std::pmr::get_default_resource())
+    : schema(&_schema), tree(&_document), alias_limit(_alias_limit), stats(_stats), frames(_resource),
+      scratch(_resource), anchors(_resource)
+  {}
+
+  // composes another document, the stacks and the anchor table keep their storage
+  void restart(std::size_t _alias_limit) noexcept
+  {
+    alias_limit = _alias_limit;
+    expanded = 0;
+    frames.clear();
+    scratch.clear();
+    anchors.clear();
+  }
+
+  // consumes the events of one node, the first event is the start of the node
+  node_ref compose(parser &_events)
+  {
+    auto root = node_ref{};
+    do root = add(pull(_events));
+    while (!root);
+    return root;
+  }
+
+  // adds the next event of a node, returns the node once its last event is added
+  node_ref add(const event &_event)
+  {
+    switch (_event.type) {
+    case event_type::scalar: {
+      auto child = construct(_event);
+      if (!_event.anchor.empty()) anchors[_event.anchor] = anchored{ child, 1 };
+      return attach(child, 1);
+    }
+    case event_type::alias: {
+      auto found = anchors.find(_event.anchor);
+      if (found == anchors.end()) throw parse_error("found undefined alias", _event.start);
+      expanded += found->second.size;
+      if (expanded > alias_limit) throw parse_error("aliases expand beyond the configured limit", _event.start);
+      return attach(found->second.node, found->second.size);
+    }
+    case event_type::sequence_start:
+    case event_type::mapping_start:
+      frames.push_back(frame{ _event.type == event_type::mapping_start, _event.anchor, scratch.size(), 1 });
+      return nullptr;
+    case event_type::sequence_end:
+    case event_type::mapping_end: {
+      auto done = frames.back();
+      frames.pop_back();
+      auto children = std::span<const node_ref>{ scratch }.subspan(done.first_child);
+      auto child = done.is_mapping ? tree->create(typename Schema::mapping{ pairs(children) })
+                                   : tree->create(typename Schema::sequence{ tree->copy(children) });
+      scratch.resize(done.first_child);
+      if (!done.anchor.empty()) anchors[done.anchor] = anchored{ child, done.size };
+      return attach(child, done.size);
+    }
+    default: throw parse_error("unexpected event while composing a node", _event.start);
+    }
+  }
+
+  // nodes visited through aliases so far
+  std::size_t expansion() const noexcept { return expanded; }
+
+  // the time spent constructing scalars goes to the construct phase of _timer, nullptr stops timing
+  void time(phase_timer *_timer) noexcept { timer = _timer; }
+
+private:
+  struct frame
+  {
+    bool is_mapping;
+    std::string_view anchor;
+    std::size_t first_child;
+    std::size_t size;// nodes of the subtree with aliases expanded
+  };
+
+  struct anchored
+  {
+    node_ref node;
+    std::size_t size;
+  };
+
+  const Schema *schema;
+  document<node> *tree;
+  std::size_t alias_limit;
+  std::size_t expanded = 0;
+  load_stats *stats;
+  phase_timer *timer = nullptr;
+  std::pmr::vector<frame> frames;
+  std::pmr::vector<node_ref> scratch;
+  // a redefined anchor replaces the previous one for the following aliases
+  std::pmr::unordered_map<std::string_view, anchored> anchors;
+
+  event pull(parser &_events)
+  {
+    if constexpr (gathers_stats<Schema>) {
+      if (stats) {
+        auto result = _events.next();
+        ++stats->events;
+        switch (result.type) {
+        case event_type::scalar: ++stats->scalars; break;
+        case event_type::alias: ++stats->aliases; break;
+        case event_type::sequence_start:
+        case event_type::mapping_start:
+          ++(result.type == event_type::sequence_start ? stats->sequences : stats->mappings);
+          stats->max_depth = std::max(stats->max_depth, frames.size() + 1);
+          break;
+        default: break;
+        }
+        return result;
+      }
+    }
+    return _events.next();
+  }
+
+  node_ref construct(const event &_event)
+  {
+    if constexpr (gathers_stats<Schema>) {
+      if (timer) {
+        auto left = timer->enter(phase::construct);
+        auto result = tree->create(schema->make_scalar(_event));
+        timer->enter(left);
+        return result;
+      }
+    }
+    return tree->create(schema->make_scalar(_event));
+  }
+
+  // the child of the open collection or the root, which is returned
+  node_ref attach(node_ref _child, std::size_t _size)
+  {
+    if (frames.empty()) return _child;
+    scratch.push_back(_child);
+    frames.back().size += _size;
+    return nullptr;
+  }
+  std::span<std::pair<node_ref, node_ref>> pairs(std::span<const node_ref> _children)
+  {
+    using pair = std::pair<node_ref, node_ref>;
+    if (_children.empty()) return {};
+    auto count = _children.size() / 2;
+    auto *data = static_cast<pair *>(tree->resource().allocate(count * sizeof(pair), alignof(pair)));
+    for (auto i = std::size_t{ 0 }; i < count; ++i)
+      std::construct_at(data + i, _children[2 * i], _children[2 * i + 1]);
+    return { data, count };
+  }
+};
+
+// composes the single document of the events into _document with _builder and returns its root, an empty stream is
+// composed as an empty plain scalar
+template<typename Schema>
+typename Schema::node *compose_events(const Schema &_schema, document<typename Schema::node> &_document,
+  parser &_events, composer<Schema> &_builder)
+{
+  _events.next();
+  if (_events.peek().type == event_type::stream_end)
+    return _document.create(_schema.make_scalar(event{ .type = event_type::scalar, .implicit = true }));
+
+  _events.next();
+  auto root = _builder.compose(_events);
+  _events.next();
+  if (_events.peek().type != event_type::stream_end)
+    throw parse_error("expected a single document in the stream", _events.peek().start);
+  return root;
+}
+
+// composes the single document of the stream into _document and returns its root, an empty stream is composed as an
+// empty plain scalar. utf-16 and utf-32 content is transcoded into the document. _alias_budget bounds the nodes
+// visited through aliases and is decreased by the expansion of the document. _stats is filled and its phases timed
+// when the schema gathers stats. the scanner, the parser and the composer take their storage from _resource
+template<typename Schema>
+typename Schema::node *compose_document(const Schema &_schema, document<typename Schema::node> &_document,
+  std::string_view _content, std::size_t &_alias_budget, load_stats *_stats = nullptr,
+  std::pmr::memory_resource *_resource = std::pmr::get_default_resource())
+{
+  auto timer = std::optional<phase_timer>{};
+  if (_stats) timer.emplace(*_stats, phase::scan);
+  auto pool = string_pool{ _document.resource() };
+  auto events = parser{ decode(_content, pool), pool, {}, false, _resource };
+  auto builder = composer{ _schema, _document, _alias_budget, _stats, _resource };
+  if (timer) {
+    timer->enter(phase::compose);
+    events.time(&*timer);
+    builder.time(&*timer);
+  }
+  auto root = compose_events(_schema, _document, events, builder);
+  if (timer) timer->enter(phase::compose);
+  _alias_budget -= builder.expansion();
+  return root;
+}
+
+// loads the single document of the stream into a tree, an empty stream is loaded as an empty plain scalar
+template<typename Schema>
+document<typename Schema::node> compose_single(const Schema &_schema, std::string_view _content, std::size_t _alias_limit)
+{
+  auto result = document<typename Schema::node>{};
+  result.set_root(compose_document(_schema, result, _content, _alias_limit));
+  return result;
+}
+
+}// namespace yaml::detail
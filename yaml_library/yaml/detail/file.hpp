@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace yaml::detail {
+
+// read only content of a whole file: regular files are mapped in memory, pipes and other special files are read into
+// a buffer. windows always uses the buffer.
+class file_content
+{
+public:
+  explicit file_content(const std::filesystem::path &_path)
+  {
+#ifdef _WIN32
+    auto file = std::ifstream{ _path, std::ios::binary };
+    if (!file) fail(_path, std::make_error_code(std::errc::no_such_file_or_directory));
+    buffer.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+    if (file.bad()) fail(_path, std::make_error_code(std::errc::io_error));
+#else
+    auto descriptor = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) fail(_path, last_error());
+    struct ::stat status;
+    if (::fstat(descriptor, &status) != 0) {
+      auto error = last_error();
+      ::close(descriptor);
+      fail(_path, error);
+    }
+
+    if (S_ISREG(status.st_mode) && status.st_size > 0) {
+      auto size = static_cast<std::size_t>(status.st_size);
+      auto *address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+      if (address != MAP_FAILED) {
+        ::madvise(address, size, MADV_SEQUENTIAL);
+        mapping = address;
+        length = size;
+        ::close(descriptor);
+        return;
+      }
+    }
+
+    char chunk[64 * 1024];
+    for (;;) {
+      auto count = ::read(descriptor, chunk, sizeof(chunk));
+      if (count > 0)
+        buffer.append(chunk, static_cast<std::size_t>(count));
+      else if (count == 0)
+        break;
+      else if (errno != EINTR) {
+        auto error = last_error();
+        ::close(descriptor);
+        fail(_path, error);
+      }
+    }
+    ::close(descriptor);
+#endif
+  }
+
+  file_content(const file_content &) = delete;
+  file_content &operator=(const file_content &) = delete;
+
+  ~file_content()
+  {
+#ifndef _WIN32
+    if (mapping) ::munmap(mapping, length);
+#endif
+  }
+
+  std::string_view view() const noexcept
+  {
+    return mapping ? std::string_view{ static_cast<const char *>(mapping), length } : std::string_view{ buffer };
+  }
+
+  bool mapped() const noexcept { return mapping != nullptr; }
+
+private:
+  void *mapping = nullptr;
+  std::size_t length = 0;
+  std::string buffer;
+
+  static std::error_code last_error() noexcept { return { errno, std::generic_category() }; }
+
+  [[noreturn]] static void fail(const std::filesystem::path &_path, std::error_code _error)
+  {
+    throw std::filesystem::filesystem_error("cannot read yaml file", _path, _error);
+  }
+};
+
+}// namespace yaml::detail
@@ -0,0 +1,503 @@
+#pragma once
+
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <yaml/detail/scanner.hpp>
+#include <yaml/error.hpp>
+#include <yaml/event.hpp>
+
+namespace yaml::detail {
+
+// pull parser turning tokens into events, the grammar is driven by an explicit state stack so the caller decides when
+// to produce the next event and no recursion is involved
+class parser
+{
+public:
+  parser(std::string_view _input, string_pool &_pool, mark _start = {}, bool _flow = false,
+    std::pmr::memory_resource *_resource = std::pmr::get_default_resource())
+    : tokens(_input, _pool, _start, _flow, _resource), pool(&_pool), stack(_resource), tag_handles(_resource)
+  {}
+
+  // parses another input as the constructor would, the stacks keep their storage
+  void reset(std::string_view _input, mark _start = {}, bool _flow = false)
+  {
+    tokens.reset(_input, _start, _flow);
+    state = states::stream_start;
+    stack.clear();
+    tag_handles.clear();
+    pending = false;
+  }
+
+  bool done() const noexcept { return state == states::end; }
+
+  const event &peek()
+  {
+    if (!pending) {
+      auto left = timer ? timer->enter(phase::parse) : phase::parse;
+      current = produce();
+      if (timer) timer->enter(left);
+      pending = true;
+    }
+    return current;
+  }
+
+  event next()
+  {
+    peek();
+    pending = false;
+    return current;
+  }
+
+  std::string_view source() const noexcept { return tokens.source(); }
+
+  // goes on with _input, which starts with the input given so far. next() and peek() throw need_input when the next
+  // event of a _partial input depends on the input still to come, a copy of the parser taken after an event then
+  // resumes from there once more input is given
+  void extend(std::string_view _input, bool _partial) { tokens.extend(_input, _partial); }
+
+  // the time spent producing events goes to the parse phase of _timer and the time spent fetching tokens to its scan
+  // phase, nullptr stops timing
+  void time(phase_timer *_timer) noexcept
+  {
+    timer = _timer;
+    tokens.time(_timer);
+  }
+
+private:
+  enum class states : std::uint8_t {
+    stream_start,
+    implicit_document_start,
+    document_start,
+    document_content,
+    document_end,
+    block_node,
+    block_sequence_first_entry,
+    block_sequence_entry,
+    indentless_sequence_entry,
+    block_mapping_first_key,
+    block_mapping_key,
+    block_mapping_value,
+    flow_sequence_first_entry,
+    flow_sequence_entry,
+    flow_sequence_entry_mapping_key,
+    flow_sequence_entry_mapping_value,
+    flow_sequence_entry_mapping_end,
+    flow_mapping_first_key,
+    flow_mapping_key,
+    flow_mapping_value,
+    flow_mapping_empty_value,
+    end
+  };
+
+  using enum token_type;
+
+  scanner tokens;
+  string_pool *pool;
+  states state = states::stream_start;
+  std::pmr::vector<states> stack;
+  std::pmr::vector<std::pair<std::string_view, std::string_view>> tag_handles;
+  event current;
+  bool pending = false;
+  phase_timer *timer = nullptr;
+
+  [[noreturn]] static void fail(std::string_view _problem, mark _where) { throw parse_error(_problem, _where); }
+
+  states pop_state()
+  {
+    auto result = stack.back();
+    stack.pop_back();
+    return result;
+  }
+
+  event produce()
+  {
+    switch (state) {
+    case states::stream_start: return parse_stream_start();
+    case states::implicit_document_start: return parse_document_start(true);
+    case states::document_start: return parse_document_start(false);
+    case states::document_content: return parse_document_content();
+    case states::document_end: return parse_document_end();
+    case states::block_node: return parse_node(true, false);
+    case states::block_sequence_first_entry: return parse_block_sequence_entry(true);
+    case states::block_sequence_entry: return parse_block_sequence_entry(false);
+    case states::indentless_sequence_entry: return parse_indentless_sequence_entry();
+    case states::block_mapping_first_key: return parse_block_mapping_key(true);
+    case states::block_mapping_key: return parse_block_mapping_key(false);
+    case states::block_mapping_value: return parse_block_mapping_value();
+    case states::flow_sequence_first_entry: return parse_flow_sequence_entry(true);
+    case states::flow_sequence_entry: return parse_flow_sequence_entry(false);
+    case states::flow_sequence_entry_mapping_key: return parse_flow_sequence_entry_mapping_key();
+    case states::flow_sequence_entry_mapping_value: return parse_flow_sequence_entry_mapping_value();
+    case states::flow_sequence_entry_mapping_end: return parse_flow_sequence_entry_mapping_end();
+    case states::flow_mapping_first_key: return parse_flow_mapping_key(true);
+    case states::flow_mapping_key: return parse_flow_mapping_key(false);
+    case states::flow_mapping_value: return parse_flow_mapping_value();
+    case states::flow_mapping_empty_value: return parse_flow_mapping_empty_value();
+    case states::end: break;
+    }
+    fail("no more events", {});
+  }
+
+  static event make(event_type _type, mark _start, mark _end)
+  {
+    return event{ .type = _type, .start = _start, .end = _end };
+  }
+
+  static event empty_scalar(mark _where)
+  {
+    return event{ .type = event_type::scalar, .implicit = true, .start = _where, .end = _where };
+  }
+
+  // --- stream & documents
+
+  event parse_stream_start()
+  {
+    auto token = tokens.next();
+    state = states::implicit_document_start;
+    return make(event_type::stream_start, token.start, token.end);
+  }
+
+  // a bare document is only allowed at the start of the stream or after an explicit document end
+  event parse_document_start(bool _implicit_allowed)
+  {
+    while (tokens.check(document_end)) {
+      tokens.next();
+      _implicit_allowed = true;
+    }
+
+    if (tokens.check(stream_end)) {
+      auto token = tokens.next();
+      state = states::end;
+      return make(event_type::stream_end, token.start, token.end);
+    }
+
+    if (_implicit_allowed && !tokens.check(version_directive, tag_directive, reserved_directive, document_start)) {
+      reset_tag_handles();
+      auto where = tokens.peek().start;
+      stack.push_back(states::document_end);
+      state = states::block_node;
+      auto result = make(event_type::document_start, where, where);
+      result.implicit = true;
+      return result;
+    }
+
+    auto start = tokens.peek().start;
+    auto version = process_directives();
+    if (!tokens.check(document_start)) fail("expected '<document start>'", tokens.peek().start);
+    auto token = tokens.next();
+    stack.push_back(states::document_end);
+    state = states::document_content;
+    auto result = make(event_type::document_start, start, token.end);
+    result.value = version;
+    return result;
+  }
+
+  event parse_document_content()
+  {
+    if (tokens.check(version_directive, tag_directive, reserved_directive, document_start, document_end, stream_end)) {
+      state = pop_state();
+      return empty_scalar(tokens.peek().start);
+    }
+    return parse_node(true, false);
+  }
+
+  event parse_document_end()
+  {
+    auto start = tokens.peek().start;
+    auto end = start;
+    auto implicit = true;
+    if (tokens.check(document_end)) {
+      end = tokens.next().end;
+      implicit = false;
+    } else if (!tokens.check(document_start, stream_end))
+      fail("expected '<document end>' or '<document start>'", start);
+    state = implicit ? states::document_start : states::implicit_document_start;
+    auto result = make(event_type::document_end, start, end);
+    result.implicit = implicit;
+    return result;
+  }
+
+  void reset_tag_handles()
+  {
+    tag_handles.clear();
+    tag_handles.emplace_back("!", "!");
+    tag_handles.emplace_back("!!", "tag:yaml.org,2002:");
+  }
+
+  std::string_view process_directives()
+  {
+    auto version = std::string_view{};
+    tag_handles.clear();
+    while (tokens.check(version_directive, tag_directive, reserved_directive)) {
+      auto token = tokens.next();
+      if (token.type == version_directive) {
+        if (!version.empty()) fail("found duplicate %YAML directive", token.start);
+        if (!token.value.starts_with("1.")) fail("found incompatible YAML document", token.start);
+        version = token.value;
+      } else if (token.type == tag_directive) {
+        for (auto &[handle, prefix] : tag_handles)
+          if (handle == token.handle) fail("found duplicate %TAG directive", token.start);
+        tag_handles.emplace_back(token.handle, token.value);
+      }
+    }
+    auto declared = [this](std::string_view _handle) {
+      for (auto &[handle, prefix] : tag_handles)
+        if (handle == _handle) return true;
+      return false;
+    };
+    if (!declared("!")) tag_handles.emplace_back("!", "!");
+    if (!declared("!!")) tag_handles.emplace_back("!!", "tag:yaml.org,2002:");
+    return version;
+  }
+
+  std::string_view resolve_tag(const token &_token)
+  {
+    if (_token.handle.empty()) return _token.value;
+    for (auto &[handle, prefix] : tag_handles) {
+      if (handle != _token.handle) continue;
+      // the primary handle is not expanded by default, the shorthand is already the tag
+      if (prefix == handle) return { _token.handle.data(), _token.handle.size() + _token.value.size() };
+      pool->restart();
+      pool->append(prefix);
+      pool->append(_token.value);
+      return pool->take();
+    }
+    fail("found undefined tag handle", _token.start);
+  }
+
+  // --- nodes
+
+  event parse_node(bool _block, bool _indentless_sequence)
+  {
+    if (tokens.check(alias)) {
+      auto token = tokens.next();
+      state = pop_state();
+      auto result = make(event_type::alias, token.start, token.end);
+      result.anchor = token.value;
+      return result;
+    }
+
+    auto anchor = std::string_view{};
+    auto tag = std::string_view{};
+    auto has_properties = false;
+    auto start = tokens.peek().start;
+    auto end = start;
+    for (auto i = 0; i < 2 && tokens.check(token_type::anchor, token_type::tag); ++i) {
+      auto token = tokens.next();
+      if (token.type == token_type::anchor) {
+        if (!anchor.empty()) fail("found duplicate anchor", token.start);
+        anchor = token.value;
+      } else {
+        if (!tag.empty()) fail("found duplicate tag", token.start);
+        tag = resolve_tag(token);
+      }
+      end = token.end;
+      has_properties = true;
+    }
+
+    auto untagged = tag.empty() || tag == "!";
+    auto collection = [&](event_type _type, bool _flow, states _next) {
+      auto token = tokens.peek();
+      state = _next;
+      auto result = event{ .type = _type, .implicit = untagged, .flow = _flow, .anchor = anchor, .tag = tag, .start = start, .end = token.end };
+      return result;
+    };
+
+    if (_indentless_sequence && tokens.check(block_entry))
+      return collection(event_type::sequence_start, false, states::indentless_sequence_entry);
+    if (tokens.check(token_type::scalar)) {
+      auto token = tokens.next();
+      state = pop_state();
+      return event{ .type = event_type::scalar,
+        .style = token.style,
+        .implicit = (token.style == scalar_style::plain && tag.empty()) || tag == "!",
+        .anchor = anchor,
+        .tag = tag,
+        .value = token.value,
+        .start = has_properties ? start : token.start,
+        .end = token.end };
+    }
+    if (tokens.check(flow_sequence_start))
+      return collection(event_type::sequence_start, true, states::flow_sequence_first_entry);
+    if (tokens.check(flow_mapping_start))
+      return collection(event_type::mapping_start, true, states::flow_mapping_first_key);
+    if (_block && tokens.check(block_sequence_start))
+      return collection(event_type::sequence_start, false, states::block_sequence_first_entry);
+    if (_block && tokens.check(block_mapping_start))
+      return collection(event_type::mapping_start, false, states::block_mapping_first_key);
+    if (has_properties) {
+      // empty node carrying properties only
+      state = pop_state();
+      auto result = empty_scalar(end);
+      result.start = start;
+      result.anchor = anchor;
+      result.tag = tag;
+      result.implicit = untagged;
+      return result;
+    }
+    fail(_block ? "expected a block node" : "expected a flow node", tokens.peek().start);
+  }
+
+  event close(event_type _type)
+  {
+    auto token = tokens.next();
+    state = pop_state();
+    return make(_type, token.start, token.end);
+  }
+
+  // an entry indicator followed by no content is an empty scalar
+  event entry_or_empty(states _next, bool _block, auto... _terminators)
+  {
+    auto token = tokens.next();
+    if (!tokens.check(_terminators...)) {
+      stack.push_back(_next);
+      return parse_node(_block, false);
+    }
+    state = _next;
+    return empty_scalar(token.end);
+  }
+
+  // --- block collections
+
+  event parse_block_sequence_entry(bool _first)
+  {
+    if (_first) tokens.next();
+    if (tokens.check(block_entry)) return entry_or_empty(states::block_sequence_entry, true, block_entry, block_end);
+    if (!tokens.check(block_end)) fail("expected '<block end>' while parsing a block sequence", tokens.peek().start);
+    return close(event_type::sequence_end);
+  }
+
+  event parse_indentless_sequence_entry()
+  {
+    if (tokens.check(block_entry))
+      return entry_or_empty(states::indentless_sequence_entry, true, block_entry, key, value, block_end);
+    auto where = tokens.peek().start;
+    state = pop_state();
+    return make(event_type::sequence_end, where, where);
+  }
+
+  event parse_block_mapping_key(bool _first)
+  {
+    if (_first) tokens.next();
+    if (tokens.check(key)) {
+      auto token = tokens.next();
+      if (!tokens.check(key, value, block_end)) {
+        stack.push_back(states::block_mapping_value);
+        return parse_node(true, true);
+      }
+      state = states::block_mapping_value;
+      return empty_scalar(token.end);
+    }
+    if (tokens.check(value)) {
+      // a mapping value without key, the key is an empty scalar
+      state = states::block_mapping_value;
+      return empty_scalar(tokens.peek().start);
+    }
+    if (!tokens.check(block_end)) fail("expected '<block end>' while parsing a block mapping", tokens.peek().start);
+    return close(event_type::mapping_end);
+  }
+
+  event parse_block_mapping_value()
+  {
+    if (tokens.check(value)) {
+      auto token = tokens.next();
+      if (!tokens.check(key, value, block_end)) {
+        stack.push_back(states::block_mapping_key);
+        return parse_node(true, true);
+      }
+      state = states::block_mapping_key;
+      return empty_scalar(token.end);
+    }
+    state = states::block_mapping_key;
+    return empty_scalar(tokens.peek().start);
+  }
+
+  // --- flow collections
+
+  event parse_flow_sequence_entry(bool _first)
+  {
+    if (_first) tokens.next();
+    if (!tokens.check(flow_sequence_end)) {
+      if (!_first) {
+        if (!tokens.check(flow_entry)) fail("expected ',' or ']' while parsing a flow sequence", tokens.peek().start);
+        tokens.next();
+      }
+      if (tokens.check(key)) {
+        // single pair mapping: [ key: value ]
+        auto token = tokens.peek();
+        state = states::flow_sequence_entry_mapping_key;
+        auto result = make(event_type::mapping_start, token.start, token.end);
+        result.implicit = true;
+        result.flow = true;
+        return result;
+      }
+      if (!tokens.check(flow_sequence_end)) {
+        stack.push_back(states::flow_sequence_entry);
+        return parse_node(false, false);
+      }
+    }
+    return close(event_type::sequence_end);
+  }
+
+  event parse_flow_sequence_entry_mapping_key()
+  {
+    return entry_or_empty(states::flow_sequence_entry_mapping_value, false, value, flow_entry, flow_sequence_end);
+  }
+
+  event parse_flow_sequence_entry_mapping_value()
+  {
+    if (tokens.check(value))
+      return entry_or_empty(states::flow_sequence_entry_mapping_end, false, flow_entry, flow_sequence_end);
+    state = states::flow_sequence_entry_mapping_end;
+    return empty_scalar(tokens.peek().start);
+  }
+
+  event parse_flow_sequence_entry_mapping_end()
+  {
+    state = states::flow_sequence_entry;
+    auto where = tokens.peek().start;
+    return make(event_type::mapping_end, where, where);
+  }
+
+  event parse_flow_mapping_key(bool _first)
+  {
+    if (_first) tokens.next();
+    if (!tokens.check(flow_mapping_end)) {
+      if (!_first) {
+        if (!tokens.check(flow_entry)) fail("expected ',' or '}' while parsing a flow mapping", tokens.peek().start);
+        tokens.next();
+      }
+      if (tokens.check(key))
+        return entry_or_empty(states::flow_mapping_value, false, value, flow_entry, flow_mapping_end);
+      if (tokens.check(value)) {
+        // { : value } has an empty key
+        state = states::flow_mapping_value;
+        return empty_scalar(tokens.peek().start);
+      }
+      if (!tokens.check(flow_mapping_end)) {
+        stack.push_back(states::flow_mapping_empty_value);
+        return parse_node(false, false);
+      }
+    }
+    return close(event_type::mapping_end);
+  }
+
+  event parse_flow_mapping_value()
+  {
+    if (tokens.check(value)) return entry_or_empty(states::flow_mapping_key, false, flow_entry, flow_mapping_end);
+    state = states::flow_mapping_key;
+    return empty_scalar(tokens.peek().start);
+  }
+
+  event parse_flow_mapping_empty_value()
+  {
+    state = states::flow_mapping_key;
+    return empty_scalar(tokens.peek().start);
+  }
+};
+
+}// namespace yaml::detail
@@ -0,0 +1,1044 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <yaml/detail/structural.hpp>
+#include <yaml/error.hpp>
+#include <yaml/event.hpp>
+#include <yaml/stats.hpp>
+
+namespace yaml::detail {
+
+// stores the content of scalars that cannot be served as a view of the input (escapes, folding, block scalars) in
+// the memory resource of the document being loaded. scalars are decoded straight into the pool: the pending string
+// grows at the end of the current block and moves to a new block when it does not fit, take() then keeps it
+class string_pool
+{
+public:
+  explicit string_pool(std::pmr::memory_resource &_resource) : resource(&_resource) {}
+
+  std::string_view store(std::string_view _content)
+  {
+    restart();
+    append(_content);
+    return take();
+  }
+
+  // drops the pending string
+  void restart() noexcept { length = 0; }
+
+  // forgets every block, once the resource they were taken from released them
+  void clear() noexcept
+  {
+    block = nullptr;
+    block_size = used = length = 0;
+    next_block = 256;
+  }
+
+  // makes room for _count more bytes of the pending string
+  void reserve(std::size_t _count)
+  {
+    if (block_size - used - length >= _count) return;
+    auto size = std::max(length + _count, next_block);
+    auto *moved = static_cast<char *>(resource->allocate(size, 1));
+    if (length) std::memcpy(moved, block + used, length);
+    block = moved;
+    block_size = size;
+    used = 0;
+    next_block = std::min(next_block * 2, max_block);
+  }
+
+  void append(std::string_view _content)
+  {
+    if (_content.empty()) return;
+    grow(_content.size());
+    std::memcpy(block + used + length, _content.data(), _content.size());
+    length += _content.size();
+  }
+
+  void append(std::size_t _count, char _c)
+  {
+    if (!_count) return;
+    grow(_count);
+    std::memset(block + used + length, _c, _count);
+    length += _count;
+  }
+
+  void push_back(char _c)
+  {
+    grow(1);
+    block[used + length++] = _c;
+  }
+
+  // end of the pending string, the caller writes there at most the bytes reserved then tells how many with extend()
+  char *tail() noexcept { return block + used + length; }
+  void extend(std::size_t _count) noexcept { length += _count; }
+
+  std::string_view pending() const noexcept { return { block + used, length }; }
+  void truncate(std::size_t _length) noexcept { length = std::min(length, _length); }
+
+  // keeps the pending string in the pool, empty strings take no space
+  std::string_view take() noexcept
+  {
+    if (!length) return {};
+    auto result = std::string_view{ block + used, length };
+    used += length;
+    length = 0;
+    return result;
+  }
+
+private:
+  // blocks double up to max_block, strings longer than a block get a block of their own
+  static constexpr std::size_t max_block = 64 * 1024;
+
+  std::pmr::memory_resource *resource;
+  char *block = nullptr;
+  std::size_t block_size = 0;
+  std::size_t used = 0;// by the strings taken
+  std::size_t length = 0;// of the pending string
+  std::size_t next_block = 256;
+
+  // growth by doubling the pending string keeps appending linear
+  void grow(std::size_t _count)
+  {
+    if (block_size - used - length < _count) reserve(std::max(_count, length));
+  }
+};
+
+constexpr bool is_break(char _c) { return _c == '\n' || _c == '\r'; }
+constexpr bool is_blank(char _c) { return _c == ' ' || _c == '\t'; }
+// the scanner reads '\0' past the end of the input
+constexpr bool is_blank_or_end(char _c) { return _c == '\0' || is_blank(_c) || is_break(_c); }
+constexpr bool is_flow_indicator(char _c) { return _c == ',' || _c == '[' || _c == ']' || _c == '{' || _c == '}'; }
+constexpr bool is_digit(char _c) { return _c >= '0' && _c <= '9'; }
+constexpr bool is_hex(char _c) { return is_digit(_c) || (_c >= 'a' && _c <= 'f') || (_c >= 'A' && _c <= 'F'); }
+
+enum class token_type : std::uint8_t {
+  stream_start,
+  stream_end,
+  version_directive,
+  tag_directive,
+  reserved_directive,
+  document_start,
+  document_end,
+  block_sequence_start,
+  block_mapping_start,
+  block_end,
+  flow_sequence_start,
+  flow_mapping_start,
+  flow_sequence_end,
+  flow_mapping_end,
+  block_entry,
+  flow_entry,
+  key,
+  value,
+  alias,
+  anchor,
+  tag,
+  scalar
+};
+
+// value holds the scalar content, the anchor/alias name, the tag suffix, the directive version/prefix/name
+// handle holds the tag handle or the TAG directive handle
+struct token
+{
+  token_type type = token_type::stream_start;
+  scalar_style style = scalar_style::plain;
+  mark start = {};
+  mark end = {};
+  std::string_view value = {};
+  std::string_view handle = {};
+};
+
+// thrown by a scanner reading a partial input when its next token may depend on the input still to come
+struct need_input
+{};
+
+// turns the character stream into tokens, indentation is converted to block start/end tokens and implicit keys are
+// detected by keeping track of the possible simple keys of each flow level
+class scanner
+{
+public:
+  // scanning may start anywhere in the input, _start locates the first character to read and _flow tells that it is
+  // inside a flow collection. the structural index, the token queue and the stacks take their storage from _resource
+  scanner(std::string_view _input, string_pool &_pool, mark _start = {}, bool _flow = false,
+    std::pmr::memory_resource *_resource = std::pmr::get_default_resource())
+    : input(_input), index(_input, _start.index, _resource), pool(&_pool), pos(_start), tokens(_resource),
+      flow_level(_flow ? 1 : 0), indents(_resource), simple_keys(flow_level + 1, std::nullopt, _resource)
+  {
+    tokens.push_back(token{ .type = token_type::stream_start });
+  }
+
+  // scans another input as the constructor would, the token queue and the indentation stacks keep their storage
+  void reset(std::string_view _input, mark _start = {}, bool _flow = false)
+  {
+    input = _input;
+    index.reset(_input, _start.index);
+    pos = _start;
+    tokens.clear();
+    tokens.push_back(token{ .type = token_type::stream_start });
+    head = 0;
+    tokens_taken = 0;
+    done = false;
+    flow_level = _flow ? 1 : 0;
+    indent = -1;
+    indents.clear();
+    allow_simple_key = true;
+    simple_keys.assign(flow_level + 1, std::nullopt);
+    partial = false;
+  }
+
+  // goes on with _input, which starts with the input given so far. a _partial input is followed by more of it: the
+  // scanner then throws need_input rather than fetching tokens that the input to come could change, and is left
+  // in an unspecified state that a copy taken beforehand restores
+  void extend(std::string_view _input, bool _partial)
+  {
+    input = _input;
+    index.reset(_input, pos.index);
+    partial = _partial;
+  }
+
+  bool check(auto... _types)
+  {
+    auto type = peek().type;
+    return ((type == _types) || ...);
+  }
+
+  const token &peek()
+  {
+    if (need_more_tokens()) {
+      auto left = timer ? timer->enter(phase::scan) : phase::scan;
+      do fetch_available_tokens();
+      while (need_more_tokens());
+      if (timer) timer->enter(left);
+    }
+    return tokens[head];
+  }
+
+  token next()
+  {
+    peek();
+    auto result = tokens[head++];
+    ++tokens_taken;
+    if (head == tokens.size()) {
+      tokens.clear();
+      head = 0;
+    }
+    return result;
+  }
+
+  std::string_view source() const noexcept { return input; }
+
+  // the time spent fetching tokens goes to the scan phase of _timer, nullptr stops timing
+  void time(phase_timer *_timer) noexcept { timer = _timer; }
+
+private:
+  struct simple_key
+  {
+    std::size_t token_number;
+    bool required;
+    mark where;
+  };
+
+  std::string_view input;
+  structural_index index;
+  string_pool *pool;
+  mark pos;
+
+  std::pmr::vector<token> tokens;
+  std::size_t head = 0;
+  std::size_t tokens_taken = 0;
+  bool done = false;
+
+  std::size_t flow_level = 0;
+  std::ptrdiff_t indent = -1;
+  std::pmr::vector<std::ptrdiff_t> indents;
+  bool allow_simple_key = true;
+  std::pmr::vector<std::optional<simple_key>> simple_keys;
+  phase_timer *timer = nullptr;
+  bool partial = false;
+
+  // --- reader
+
+  char look(std::size_t _offset) const noexcept
+  {
+    auto index = pos.index + _offset;
+    return index < input.size() ? input[index] : '\0';
+  }
+  char look() const noexcept { return look(0); }
+
+  void forward(std::size_t _count = 1) noexcept
+  {
+    for (; _count && pos.index < input.size(); --_count) {
+      auto c = input[pos.index++];
+      if (c == '\n' || (c == '\r' && look() != '\n')) {
+        ++pos.line;
+        pos.column = 0;
+      } else
+        ++pos.column;
+    }
+  }
+
+  // advances within the current line, the caller guarantees no line break is skipped
+  void forward_inline(std::size_t _count) noexcept
+  {
+    pos.index += _count;
+    pos.column += _count;
+  }
+
+  void skip_to_line_end() { forward_inline(index.next_break(pos.index) - pos.index); }
+
+  // position of the first structural byte from _from accepted by _stop, the end of the input if there is none
+  std::size_t find_structural(std::size_t _from, auto _stop)
+  {
+    for (auto at = index.next_structural(_from); at < input.size(); at = index.next_structural(at + 1))
+      if (_stop(input[at], at)) return at;
+    return input.size();
+  }
+
+  bool skip_line_break() noexcept
+  {
+    auto c = look();
+    if (c == '\r' && look(1) == '\n') {
+      forward(2);
+      return true;
+    }
+    if (is_break(c)) {
+      forward();
+      return true;
+    }
+    return false;
+  }
+
+  std::string_view slice(std::size_t _begin, std::size_t _end) const noexcept
+  {
+    return input.substr(_begin, _end - _begin);
+  }
+
+  [[noreturn]] void fail(std::string_view _problem) const { throw parse_error(_problem, pos); }
+  [[noreturn]] static void fail(std::string_view _problem, mark _where) { throw parse_error(_problem, _where); }
+
+  bool at_document_indicator(char _c) const noexcept
+  {
+    return pos.column == 0 && look() == _c && look(1) == _c && look(2) == _c && is_blank_or_end(look(3));
+  }
+
+  bool at_document_separator() const noexcept { return at_document_indicator('-') || at_document_indicator('.'); }
+
+  // --- token queue
+
+  void push(token_type _type, mark _start, mark _end, std::string_view _value = {}, std::string_view _handle = {})
+  {
+    tokens.push_back(token{ .type = _type, .start = _start, .end = _end, .value = _value, .handle = _handle });
+  }
+
+  bool need_more_tokens()
+  {
+    if (done) return false;
+    if (head == tokens.size()) return true;
+    stale_possible_simple_keys();
+    return next_possible_simple_key() == tokens_taken;
+  }
+
+  std::optional<std::size_t> next_possible_simple_key() const noexcept
+  {
+    auto result = std::optional<std::size_t>{};
+    for (auto &key : simple_keys)
+      if (key && (!result || key->token_number < *result)) result = key->token_number;
+    return result;
+  }
+
+  // a simple key is limited to a single line and 1024 characters
+  void stale_possible_simple_keys()
+  {
+    for (auto &key : simple_keys) {
+      if (key && (key->where.line != pos.line || pos.index - key->where.index > 1024)) {
+        if (key->required) fail("could not find expected ':'", key->where);
+        key.reset();
+      }
+    }
+  }
+
+  void save_possible_simple_key()
+  {
+    auto required = flow_level == 0 && indent == static_cast<std::ptrdiff_t>(pos.column);
+    if (allow_simple_key) {
+      remove_possible_simple_key();
+      simple_keys[flow_level] = simple_key{ tokens_taken + tokens.size() - head, required, pos };
+    }
+  }
+
+  void remove_possible_simple_key()
+  {
+    auto &key = simple_keys[flow_level];
+    if (key && key->required) fail("could not find expected ':'", key->where);
+    key.reset();
+  }
+
+  void unwind_indent(std::ptrdiff_t _column)
+  {
+    if (flow_level) return;
+    while (indent > _column) {
+      push(token_type::block_end, pos, pos);
+      indent = indents.back();
+      indents.pop_back();
+    }
+  }
+
+  bool add_indent(std::ptrdiff_t _column)
+  {
+    if (indent >= _column) return false;
+    indents.push_back(indent);
+    indent = _column;
+    return true;
+  }
+
+  // --- dispatch
+
+  // bytes a token may be decided on past its end: a document marker and the blank following it
+  static constexpr std::size_t lookahead = 4;
+
+  // the tokens fetched from a partial input, and the errors found in it, only count when every byte they were decided
+  // on has been received
+  void fetch_available_tokens()
+  {
+    if (!partial) return fetch_more_tokens();
+    try {
+      fetch_more_tokens();
+    } catch (const parse_error &) {
+      if (pos.index + lookahead > input.size()) throw need_input{};
+      throw;
+    }
+    if (pos.index + lookahead > input.size()) throw need_input{};
+  }
+
+  void fetch_more_tokens()
+  {
+    scan_to_next_token();
+    stale_possible_simple_keys();
+    unwind_indent(static_cast<std::ptrdiff_t>(pos.column));
+
+    auto c = look();
+    if (pos.index >= input.size()) return fetch_stream_end();
+    if (c == '%' && pos.column == 0) return fetch_directive();
+    if (at_document_indicator('-')) return fetch_document_indicator(token_type::document_start);
+    if (at_document_indicator('.')) return fetch_document_indicator(token_type::document_end);
+
+    switch (c) {
+    case '[': return fetch_flow_collection_start(token_type::flow_sequence_start);
+    case '{': return fetch_flow_collection_start(token_type::flow_mapping_start);
+    case ']': return fetch_flow_collection_end(token_type::flow_sequence_end);
+    case '}': return fetch_flow_collection_end(token_type::flow_mapping_end);
+    case ',': return fetch_flow_entry();
+    case '*': return fetch_alias_or_anchor(token_type::alias);
+    case '&': return fetch_alias_or_anchor(token_type::anchor);
+    case '!': return fetch_tag();
+    case '\'': return fetch_flow_scalar(false);
+    case '"': return fetch_flow_scalar(true);
+    default: break;
+    }
+
+    auto blank_next = is_blank_or_end(look(1));
+    if (c == '-' && blank_next) return fetch_block_entry();
+    if (c == '?' && (flow_level || blank_next)) return fetch_key();
+    if (c == ':' && (flow_level || blank_next)) return fetch_value();
+    if (c == '|' && !flow_level) return fetch_block_scalar(false);
+    if (c == '>' && !flow_level) return fetch_block_scalar(true);
+    if (check_plain()) return fetch_plain();
+
+    fail("found character that cannot start any token");
+  }
+
+  bool check_plain() const noexcept
+  {
+    auto c = look();
+    switch (c) {
+    case '-':
+    case '?':
+    case ':': return !is_blank_or_end(look(1)) && !(flow_level && is_flow_indicator(look(1)));
+    case '#':
+    case '&':
+    case '*':
+    case '!':
+    case '|':
+    case '>':
+    case '\'':
+    case '"':
+    case '%':
+    case '@':
+    case '`': return false;
+    default: return !is_blank_or_end(c) && !is_flow_indicator(c);
+    }
+  }
+
+  void scan_to_next_token()
+  {
+    // the byte order mark takes no column
+    if (pos.index == 0 && input.starts_with("\xEF\xBB\xBF")) pos.index = 3;
+    for (;;) {
+      while (is_blank(look())) forward_inline(1);
+      if (look() == '#')
+        skip_to_line_end();
+      if (!skip_line_break()) return;
+      if (!flow_level) allow_simple_key = true;
+    }
+  }
+
+  void fetch_stream_end()
+  {
+    unwind_indent(-1);
+    remove_possible_simple_key();
+    allow_simple_key = false;
+    for (auto &key : simple_keys) key.reset();
+    push(token_type::stream_end, pos, pos);
+    done = true;
+  }
+
+  void fetch_directive()
+  {
+    unwind_indent(-1);
+    remove_possible_simple_key();
+    allow_simple_key = false;
+    scan_directive();
+  }
+
+  void fetch_document_indicator(token_type _type)
+  {
+    unwind_indent(-1);
+    remove_possible_simple_key();
+    allow_simple_key = false;
+    auto start = pos;
+    forward_inline(3);
+    push(_type, start, pos);
+  }
+
+  void fetch_flow_collection_start(token_type _type)
+  {
+    save_possible_simple_key();
+    ++flow_level;
+    if (simple_keys.size() <= flow_level) simple_keys.resize(flow_level + 1);
+    allow_simple_key = true;
+    auto start = pos;
+    forward_inline(1);
+    push(_type, start, pos);
+  }
+
+  void fetch_flow_collection_end(token_type _type)
+  {
+    remove_possible_simple_key();
+    if (flow_level) --flow_level;
+    allow_simple_key = false;
+    auto start = pos;
+    forward_inline(1);
+    push(_type, start, pos);
+  }
+
+  void fetch_flow_entry()
+  {
+    allow_simple_key = true;
+    remove_possible_simple_key();
+    auto start = pos;
+    forward_inline(1);
+    push(token_type::flow_entry, start, pos);
+  }
+
+  void fetch_block_entry()
+  {
+    if (!flow_level) {
+      if (!allow_simple_key) fail("sequence entries are not allowed here");
+      if (add_indent(static_cast<std::ptrdiff_t>(pos.column))) push(token_type::block_sequence_start, pos, pos);
+    }
+    allow_simple_key = true;
+    remove_possible_simple_key();
+    auto start = pos;
+    forward_inline(1);
+    push(token_type::block_entry, start, pos);
+  }
+
+  void fetch_key()
+  {
+    if (!flow_level) {
+      if (!allow_simple_key) fail("mapping keys are not allowed here");
+      if (add_indent(static_cast<std::ptrdiff_t>(pos.column))) push(token_type::block_mapping_start, pos, pos);
+    }
+    allow_simple_key = !flow_level;
+    remove_possible_simple_key();
+    auto start = pos;
+    forward_inline(1);
+    push(token_type::key, start, pos);
+  }
+
+  void fetch_value()
+  {
+    if (auto &key = simple_keys[flow_level]) {
+      // the key was scanned before we knew it was one, insert the key token (and the mapping start) retroactively
+      auto at = tokens.begin() + static_cast<std::ptrdiff_t>(head + key->token_number - tokens_taken);
+      at = tokens.insert(at, token{ .type = token_type::key, .start = key->where, .end = key->where });
+      if (!flow_level && add_indent(static_cast<std::ptrdiff_t>(key->where.column)))
+        tokens.insert(at, token{ .type = token_type::block_mapping_start, .start = key->where, .end = key->where });
+      key.reset();
+      allow_simple_key = false;
+    } else {
+      if (!flow_level) {
+        if (!allow_simple_key) fail("mapping values are not allowed here");
+        if (add_indent(static_cast<std::ptrdiff_t>(pos.column))) push(token_type::block_mapping_start, pos, pos);
+      }
+      allow_simple_key = !flow_level;
+      remove_possible_simple_key();
+    }
+    auto start = pos;
+    forward_inline(1);
+    push(token_type::value, start, pos);
+  }
+
+  void fetch_alias_or_anchor(token_type _type)
+  {
+    save_possible_simple_key();
+    allow_simple_key = false;
+    auto start = pos;
+    forward_inline(1);
+    auto begin = pos.index;
+    while (!is_blank_or_end(look()) && !is_flow_indicator(look())) forward_inline(1);
+    if (pos.index == begin)
+      fail(_type == token_type::alias ? "expected alias name" : "expected anchor name", start);
+    push(_type, start, pos, slice(begin, pos.index));
+  }
+
+  void fetch_tag()
+  {
+    save_possible_simple_key();
+    allow_simple_key = false;
+    scan_tag();
+  }
+
+  void fetch_block_scalar(bool _folded)
+  {
+    allow_simple_key = true;
+    remove_possible_simple_key();
+    scan_block_scalar(_folded);
+  }
+
+  void fetch_flow_scalar(bool _double)
+  {
+    save_possible_simple_key();
+    allow_simple_key = false;
+    scan_flow_scalar(_double);
+  }
+
+  void fetch_plain()
+  {
+    save_possible_simple_key();
+    allow_simple_key = false;
+    scan_plain();
+  }
+
+  // --- directives
+
+  void skip_directive_line()
+  {
+    while (is_blank(look())) forward_inline(1);
+    if (look() == '#')
+      skip_to_line_end();
+    if (!skip_line_break() && pos.index < input.size()) fail("expected a comment or a line break after a directive");
+  }
+
+  std::string_view scan_directive_word()
+  {
+    while (is_blank(look())) forward_inline(1);
+    auto begin = pos.index;
+    while (!is_blank_or_end(look())) forward_inline(1);
+    return slice(begin, pos.index);
+  }
+
+  void scan_directive()
+  {
+    auto start = pos;
+    forward_inline(1);
+    auto name = scan_directive_word();
+    if (name == "YAML") {
+      auto version = scan_directive_word();
+      auto dot = version.find('.');
+      if (dot == std::string_view::npos || dot == 0 || dot + 1 == version.size()
+          || !std::ranges::all_of(version.substr(0, dot), is_digit)
+          || !std::ranges::all_of(version.substr(dot + 1), is_digit))
+        fail("expected a version number of the form major.minor", start);
+      push(token_type::version_directive, start, pos, version);
+    } else if (name == "TAG") {
+      auto handle = scan_directive_word();
+      auto prefix = scan_directive_word();
+      if (handle.empty() || handle.front() != '!' || handle.back() != '!' || prefix.empty())
+        fail("expected a tag handle and a tag prefix", start);
+      push(token_type::tag_directive, start, pos, prefix, handle);
+    } else {
+      if (name.empty()) fail("expected a directive name", start);
+      skip_to_line_end();
+      push(token_type::reserved_directive, start, pos, name);
+    }
+    skip_directive_line();
+  }
+
+  // --- node properties
+
+  void scan_tag()
+  {
+    auto start = pos;
+    auto handle = std::string_view{};
+    auto suffix = std::string_view{};
+    if (look(1) == '<') {
+      // verbatim tag, not subject to resolution
+      forward_inline(2);
+      auto begin = pos.index;
+      while (look() != '>' && !is_blank_or_end(look())) forward_inline(1);
+      if (look() != '>' || pos.index == begin) fail("expected a verbatim tag ending with '>'", start);
+      suffix = slice(begin, pos.index);
+      forward_inline(1);
+    } else if (is_blank_or_end(look(1)) || (flow_level && is_flow_indicator(look(1)))) {
+      // non specific tag
+      suffix = slice(pos.index, pos.index + 1);
+      forward_inline(1);
+    } else {
+      auto length = std::size_t{ 1 };
+      while (!is_blank_or_end(look(length)) && look(length) != '!' && !(flow_level && is_flow_indicator(look(length))))
+        ++length;
+      if (look(length) == '!') ++length;
+      else
+        length = 1;
+      handle = slice(pos.index, pos.index + length);
+      forward_inline(length);
+      auto begin = pos.index;
+      while (!is_blank_or_end(look()) && !(flow_level && is_flow_indicator(look()))) forward_inline(1);
+      suffix = slice(begin, pos.index);
+      if (suffix.empty() && handle != "!") fail("expected a tag suffix", start);
+    }
+    if (!is_blank_or_end(look()) && !(flow_level && is_flow_indicator(look())))
+      fail("expected a blank after a tag", start);
+    push(token_type::tag, start, pos, suffix, handle);
+  }
+
+  // --- scalars
+
+  void scan_plain()
+  {
+    auto start = pos;
+    auto end = pos;
+    auto min_indent = indent + 1;
+    auto multiline = false;
+    // separators are only appended once the next chunk is known to belong to the scalar
+    auto spaces = std::string_view{};
+    auto breaks = std::size_t{ 0 };
+    auto folding = false;
+
+    for (;;) {
+      if (look() == '#') break;
+      auto length = find_structural(pos.index, [this](char _c, std::size_t _at) {
+        if (is_blank_or_end(_c)) return true;
+        auto next = _at + 1 < input.size() ? input[_at + 1] : '\0';
+        if (_c == ':' && (is_blank_or_end(next) || (flow_level && is_flow_indicator(next)))) return true;
+        return flow_level && is_flow_indicator(_c);
+      }) - pos.index;
+      if (length == 0) break;
+
+      // separation spaces are kept verbatim as long as the scalar stays on a single line, a line break is folded into
+      // a space and empty lines are kept as line breaks
+      if (folding) {
+        if (!multiline) {
+          pool->restart();
+          pool->append(slice(start.index, end.index));
+        }
+        multiline = true;
+        if (breaks)
+          pool->append(breaks, '\n');
+        else
+          pool->push_back(' ');
+      } else if (multiline)
+        pool->append(spaces);
+      if (multiline) pool->append(slice(pos.index, pos.index + length));
+      forward_inline(length);
+      end = pos;
+      folding = false;
+      breaks = 0;
+
+      auto spaces_begin = pos.index;
+      while (is_blank(look())) forward_inline(1);
+      if (!is_break(look())) {
+        if (pos.index == spaces_begin || look() == '#' || pos.index >= input.size()) break;
+        spaces = slice(spaces_begin, pos.index);
+        continue;
+      }
+
+      skip_line_break();
+      allow_simple_key = true;
+      while (!at_document_separator()) {
+        while (is_blank(look())) forward_inline(1);
+        if (!skip_line_break()) break;
+        ++breaks;
+      }
+      if (at_document_separator() || (!flow_level && static_cast<std::ptrdiff_t>(pos.column) < min_indent)
+          || pos.index >= input.size()) {
+        break;
+      }
+      folding = true;
+    }
+
+    auto value = multiline ? pool->take() : slice(start.index, end.index);
+    tokens.push_back(
+      token{ .type = token_type::scalar, .style = scalar_style::plain, .start = start, .end = end, .value = value });
+  }
+
+  // quoted scalars on a single line without escapes are served as views of the input. the others are decoded into the
+  // pool: a first pass finds the closing quote, which bounds the decoded size, then the runs between escapes and line
+  // breaks are copied whole. only the \\L and \\P escapes decode to more bytes than they take, one more each
+  void scan_flow_scalar(bool _double)
+  {
+    auto start = pos;
+    auto style = _double ? scalar_style::double_quoted : scalar_style::single_quoted;
+    auto quote = look();
+    auto find = simd::quoted_active();
+    auto escapes = std::size_t{ 0 };
+    auto single_line = true;
+    auto end = find(input.data(), input.size(), pos.index + 1, quote);
+    for (; end < input.size(); end = find(input.data(), input.size(), end, quote)) {
+      auto c = input[end];
+      if (c == '\0') {
+        end = input.size();
+        break;
+      }
+      // an escape or a doubled single quote takes two bytes, a backslash is plain in single quotes
+      auto escape = (c == quote && !_double && end + 1 < input.size() && input[end + 1] == '\'')
+                    || (c == '\\' && _double);
+      if (c == quote && !escape) break;
+      if (is_break(c)) single_line = false;
+      escapes += escape ? 1 : 0;
+      end += escape ? 2 : 1;
+    }
+
+    if (end < input.size() && single_line && !escapes) {
+      auto value = slice(pos.index + 1, end);
+      forward_inline(end + 1 - pos.index);
+      tokens.push_back(token{ .type = token_type::scalar, .style = style, .start = start, .end = pos, .value = value });
+      return;
+    }
+
+    forward_inline(1);
+    pool->restart();
+    if (end < input.size()) pool->reserve(end - pos.index + escapes);
+    // decoded bytes trailing white spaces cannot be trimmed from: escapes and folded line breaks
+    auto kept = std::size_t{ 0 };
+    for (;;) {
+      auto stop = find(input.data(), input.size(), pos.index, quote);
+      pool->append(slice(pos.index, stop));
+      forward_inline(stop - pos.index);
+      if (pos.index >= input.size()) fail("found unexpected end of stream while scanning a quoted scalar", start);
+
+      auto c = look();
+      if (c == quote && !_double && look(1) == '\'') {
+        pool->push_back('\'');
+        forward_inline(2);
+      } else if (c == quote)
+        break;
+      else if (c == '\\' && _double) {
+        forward_inline(1);
+        scan_escape(start);
+      } else if (c == '\\') {
+        pool->push_back(c);
+        forward_inline(1);
+      } else if (is_break(c)) {
+        // trailing white spaces are discarded, a line break is folded into a space unless followed by empty lines
+        auto text = pool->pending();
+        auto trimmed = text.find_last_not_of(" \t");
+        pool->truncate(std::max(kept, trimmed == std::string_view::npos ? 0 : trimmed + 1));
+        skip_line_break();
+        if (auto breaks = scan_flow_scalar_breaks(start))
+          pool->append(breaks, '\n');
+        else
+          pool->push_back(' ');
+      } else
+        fail("found unexpected character while scanning a quoted scalar");
+      kept = pool->pending().size();
+    }
+    forward_inline(1);
+    tokens.push_back(token{ .type = token_type::scalar, .style = style, .start = start, .end = pos, .value = pool->take() });
+  }
+
+  void scan_escape(mark _start)
+  {
+    auto c = look();
+    auto code_length = std::size_t{ 0 };
+    switch (c) {
+    case '0': pool->push_back('\0'); break;
+    case 'a': pool->push_back('\a'); break;
+    case 'b': pool->push_back('\b'); break;
+    case 't':
+    case '\t': pool->push_back('\t'); break;
+    case 'n': pool->push_back('\n'); break;
+    case 'v': pool->push_back('\v'); break;
+    case 'f': pool->push_back('\f'); break;
+    case 'r': pool->push_back('\r'); break;
+    case 'e': pool->push_back('\x1B'); break;
+    case ' ': pool->push_back(' '); break;
+    case '"': pool->push_back('"'); break;
+    case '/': pool->push_back('/'); break;
+    case '\\': pool->push_back('\\'); break;
+    case 'N': append_utf8(0x85); break;
+    case '_': append_utf8(0xA0); break;
+    case 'L': append_utf8(0x2028); break;
+    case 'P': append_utf8(0x2029); break;
+    case 'x': code_length = 2; break;
+    case 'u': code_length = 4; break;
+    case 'U': code_length = 8; break;
+    case '\r':
+    case '\n':
+      // an escaped line break preserves the preceding white spaces and is not folded
+      skip_line_break();
+      pool->append(scan_flow_scalar_breaks(_start), '\n');
+      return;
+    default: fail("found unknown escape character while scanning a double quoted scalar");
+    }
+    forward_inline(1);
+    if (code_length) {
+      auto code = char32_t{ 0 };
+      for (auto i = std::size_t{ 0 }; i < code_length; ++i) {
+        auto digit = look(i);
+        if (!is_hex(digit)) fail("expected an hexadecimal escape sequence");
+        code = code * 16 + static_cast<char32_t>(is_digit(digit) ? digit - '0' : (digit | 0x20) - 'a' + 10);
+      }
+      if (code > 0x10FFFF) fail("found an escape sequence outside of the unicode range");
+      append_utf8(code);
+      forward_inline(code_length);
+    }
+  }
+
+  void append_utf8(char32_t _code)
+  {
+    if (_code < 0x80)
+      pool->push_back(static_cast<char>(_code));
+    else if (_code < 0x800) {
+      pool->push_back(static_cast<char>(0xC0 | (_code >> 6)));
+      pool->push_back(static_cast<char>(0x80 | (_code & 0x3F)));
+    } else if (_code < 0x10000) {
+      pool->push_back(static_cast<char>(0xE0 | (_code >> 12)));
+      pool->push_back(static_cast<char>(0x80 | ((_code >> 6) & 0x3F)));
+      pool->push_back(static_cast<char>(0x80 | (_code & 0x3F)));
+    } else {
+      pool->push_back(static_cast<char>(0xF0 | (_code >> 18)));
+      pool->push_back(static_cast<char>(0x80 | ((_code >> 12) & 0x3F)));
+      pool->push_back(static_cast<char>(0x80 | ((_code >> 6) & 0x3F)));
+      pool->push_back(static_cast<char>(0x80 | (_code & 0x3F)));
+    }
+  }
+
+  std::size_t scan_flow_scalar_breaks(mark _start)
+  {
+    auto breaks = std::size_t{ 0 };
+    for (;;) {
+      if (at_document_separator()) fail("found unexpected document separator while scanning a quoted scalar", _start);
+      while (is_blank(look())) forward_inline(1);
+      if (!skip_line_break()) return breaks;
+      ++breaks;
+    }
+  }
+
+  void scan_block_scalar(bool _folded)
+  {
+    auto start = pos;
+    forward_inline(1);
+
+    // header: chomping and indentation indicators in any order
+    enum class chomping { clip, strip, keep } chomp = chomping::clip;
+    auto increment = std::ptrdiff_t{ 0 };
+    for (auto i = 0; i < 2; ++i) {
+      auto c = look();
+      if ((c == '+' || c == '-') && chomp == chomping::clip) {
+        chomp = c == '+' ? chomping::keep : chomping::strip;
+        forward_inline(1);
+      } else if (is_digit(c) && increment == 0) {
+        if (c == '0') fail("expected an indentation indicator in the range 1-9");
+        increment = c - '0';
+        forward_inline(1);
+      }
+    }
+    while (is_blank(look())) forward_inline(1);
+    if (look() == '#')
+      skip_to_line_end();
+    if (!skip_line_break() && pos.index < input.size())
+      fail("expected a comment or a line break after a block scalar header", start);
+
+    auto min_indent = std::max<std::ptrdiff_t>(indent + 1, 0);
+    auto block_indent = std::ptrdiff_t{ 0 };
+    auto breaks = std::size_t{ 0 };
+    auto end = pos;
+    if (increment) {
+      block_indent = std::max<std::ptrdiff_t>(indent, 0) + increment;
+      breaks = scan_block_scalar_breaks(block_indent, end);
+    } else {
+      // auto detection, the content indentation is the one of the first non empty line
+      auto max_indent = std::ptrdiff_t{ 0 };
+      while (look() == ' ' || is_break(look())) {
+        if (look() == ' ') {
+          forward_inline(1);
+          max_indent = std::max(max_indent, static_cast<std::ptrdiff_t>(pos.column));
+        } else {
+          skip_line_break();
+          ++breaks;
+          end = pos;
+        }
+      }
+      block_indent = std::max(min_indent, max_indent);
+    }
+
+    pool->restart();
+    auto trailing = std::size_t{ 0 };// pending line break of the last content line
+    auto leading_blank = false;
+    auto first = true;
+    while (static_cast<std::ptrdiff_t>(pos.column) == block_indent && pos.index < input.size()
+           && !(block_indent == 0 && at_document_separator())) {
+      auto more_indented = is_blank(look());
+      if (!first) {
+        // folding only applies between two lines that are not more indented
+        if (_folded && trailing == 1 && !leading_blank && !more_indented) {
+          if (breaks == 0) pool->push_back(' ');
+        } else
+          pool->append(trailing, '\n');
+      }
+      pool->append(breaks, '\n');
+      leading_blank = more_indented;
+      first = false;
+
+      auto begin = pos.index;
+      skip_to_line_end();
+      pool->append(slice(begin, pos.index));
+      end = pos;
+      trailing = skip_line_break() ? 1 : 0;
+      breaks = scan_block_scalar_breaks(block_indent, end);
+    }
+
+    if (chomp != chomping::strip) pool->append(first ? 0 : trailing, '\n');
+    if (chomp == chomping::keep) pool->append(breaks, '\n');
+
+    auto style = _folded ? scalar_style::folded : scalar_style::literal;
+    tokens.push_back(token{ .type = token_type::scalar, .style = style, .start = start, .end = end, .value = pool->take() });
+  }
+
+  std::size_t scan_block_scalar_breaks(std::ptrdiff_t _indent, mark &_end)
+  {
+    auto breaks = std::size_t{ 0 };
+    while (static_cast<std::ptrdiff_t>(pos.column) < _indent && look() == ' ') forward_inline(1);
+    while (is_break(look())) {
+      skip_line_break();
+      ++breaks;
+      _end = pos;
+      while (static_cast<std::ptrdiff_t>(pos.column) < _indent && look() == ' ') forward_inline(1);
+    }
+    return breaks;
+  }
+};
+
+}// namespace yaml::detail
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include <yaml/detail/scanner.hpp>
+#include <yaml/detail/structural.hpp>
+
+namespace yaml::detail {
+
+// finds the documents of a stream line by line without parsing them: document markers can only start a line, so a
+// document begins with its first content line or its --- marker and ends before the next --- marker or with a ...
+// marker. directives and comments preceding a document belong to it.
+class document_splitter
+{
+public:
+  enum class split : std::uint8_t {
+    none,
+    before,// the document ends before the line, which opens the next one
+    after,// the document ends with the line
+    drop// the lines read since the last document hold no document
+  };
+
+  split next_line(std::string_view _line) noexcept
+  {
+    if (is_marker(_line, '-')) {
+      directives = false;
+      return std::exchange(started, true) ? split::before : split::none;
+    }
+    if (is_marker(_line, '.')) {
+      directives = true;
+      return std::exchange(started, false) ? split::after : split::drop;
+    }
+    if (!is_empty(_line) && !(directives && _line.front() == '%')) {
+      started = true;
+      directives = false;
+    }
+    return split::none;
+  }
+
+  // ends the stream, true when the lines read since the last document hold one
+  bool finish() noexcept { return std::exchange(started, false); }
+
+private:
+  bool started = false;
+  bool directives = true;
+
+  static bool is_marker(std::string_view _line, char _c) noexcept
+  {
+    return _line.size() >= 3 && _line[0] == _c && _line[1] == _c && _line[2] == _c
+           && (_line.size() == 3 || is_blank_or_end(_line[3]));
+  }
+
+  // blank or comment line
+  static bool is_empty(std::string_view _line) noexcept
+  {
+    auto first = _line.find_first_not_of(" \t");
+    return first == std::string_view::npos || is_break(_line[first]) || _line[first] == '#';
+  }
+};
+
+// where the top level collection of a single document starts its entries
+struct block_root
+{
+  std::size_t body = 0;// first line of the collection
+  bool sequence = false;
+};
+
+inline char at(std::string_view _content, std::size_t _position) noexcept
+{
+  return _position < _content.size() ? _content[_position] : '\0';
+}
+
+inline bool is_marker_at(std::string_view _content, std::size_t _position, char _c) noexcept
+{
+  return at(_content, _position) == _c && at(_content, _position + 1) == _c && at(_content, _position + 2) == _c
+         && is_blank_or_end(at(_content, _position + 3));
+}
+
+// start of the line after _position, the content size on the last line
+inline std::size_t next_line(std::string_view _content, structural_index &_index, std::size_t _position)
+{
+  auto end = _index.next_break(_position);
+  if (end < _content.size() && _content[end] == '\r' && at(_content, end + 1) == '\n') ++end;
+  return std::min(end + 1, _content.size());
+}
+
+// the top level block collection of the content, none when the document has directives, properties or flow content
+// at its root or is not a block collection starting at the first column
+inline std::optional<block_root> find_block_root(std::string_view _content)
+{
+  auto index = structural_index{ _content };
+  auto position = _content.starts_with("\xEF\xBB\xBF") ? std::size_t{ 3 } : std::size_t{ 0 };
+  auto started = false;
+  for (; position < _content.size(); position = next_line(_content, index, position)) {
+    auto c = _content[position];
+    if (is_break(c) || c == '#') continue;
+    if (!started && is_marker_at(_content, position, '-')) {
+      auto rest = position + 3;
+      while (is_blank(at(_content, rest))) ++rest;
+      if (!is_break(at(_content, rest)) && at(_content, rest) != '#' && rest < _content.size()) return std::nullopt;
+      started = true;
+      continue;
+    }
+    if (is_marker_at(_content, position, '.')) return std::nullopt;
+    if (is_blank(c)) {
+      auto first = position;
+      while (is_blank(at(_content, first))) ++first;
+      if (is_break(at(_content, first)) || at(_content, first) == '#' || first == _content.size()) continue;
+      return std::nullopt;
+    }
+    switch (c) {
+    case '%':
+    case '[':
+    case '{':
+    case '&':
+    case '!':
+    case '*':
+    case '|':
+    case '>':
+    case '@':
+    case '`': return std::nullopt;
+    default: break;
+    }
+    return block_root{ position, c == '-' && is_blank_or_end(at(_content, position + 1)) };
+  }
+  return std::nullopt;
+}
+
+// a line starting an entry of the top level collection on its own: for a mapping a key at the first column that
+// is neither a sequence entry, which can be the value of the previous key, nor the value of an explicit key
+inline bool is_entry_line(std::string_view _content, std::size_t _position, bool _sequence) noexcept
+{
+  auto c = at(_content, _position);
+  auto blank_next = is_blank_or_end(at(_content, _position + 1));
+  if (_sequence) return c == '-' && blank_next;
+  if (is_blank_or_end(c) || c == '#' || c == '%') return false;
+  if ((c == '-' || c == ':') && blank_next) return false;
+  return !is_marker_at(_content, _position, '-') && !is_marker_at(_content, _position, '.');
+}
+
+// true when a line of the text other than the first one is a document marker
+inline bool has_marker(std::string_view _text) noexcept
+{
+  for (auto position = _text.find('\n'); position != std::string_view::npos; position = _text.find('\n', position + 1))
+    if (is_marker_at(_text, position + 1, '-') || is_marker_at(_text, position + 1, '.')) return true;
+  return false;
+}
+
+}// namespace yaml::detail
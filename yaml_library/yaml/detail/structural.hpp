@@ -0,0 +1,346 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#if !defined(YAML_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#define YAML_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define YAML_TARGET(_isa)
+#else
+#define YAML_TARGET(_isa) __attribute__((target(_isa)))
+#endif
+#endif
+
+namespace yaml::detail {
+
+// bytes ending a run of scalar content: white spaces, line breaks, ':' ',' '[' ']' '{' '}' '#', quotes, '\' and the
+// nul character the scanner treats as the end of the input. the other indicators (- ? & * ! | > % @ `) only matter
+// where a token starts and are checked there by the scanner
+constexpr bool is_structural(char _c)
+{
+  switch (_c) {
+  case '\0':
+  case ' ':
+  case '\t':
+  case '\n':
+  case '\r':
+  case ':':
+  case ',':
+  case '[':
+  case ']':
+  case '{':
+  case '}':
+  case '#':
+  case '\'':
+  case '"':
+  case '\\': return true;
+  default: return false;
+  }
+}
+
+// bit i of each mask is set when byte i of a 64 byte block is structural / a line break
+struct block_masks
+{
+  std::uint64_t structural = 0;
+  std::uint64_t breaks = 0;
+};
+
+namespace simd {
+
+  using classifier = block_masks (*)(const char *);
+
+  inline block_masks classify_scalar(const char *_block)
+  {
+    static constexpr auto table = [] {
+      auto result = std::array<bool, 256>{};
+      for (auto c = 0; c < 256; ++c) result[static_cast<std::size_t>(c)] = is_structural(static_cast<char>(c));
+      return result;
+    }();
+    auto result = block_masks{};
+    for (auto i = 0; i < 64; ++i) {
+      auto c = _block[i];
+      result.structural |= std::uint64_t{ table[static_cast<unsigned char>(c)] } << i;
+      result.breaks |= std::uint64_t{ c == '\n' || c == '\r' } << i;
+    }
+    return result;
+  }
+
+  // position of the first byte from _from ending a run of quoted scalar content: the quote, a backslash, a line break
+  // or the nul character, _size when there is none
+  using quoted_finder = std::size_t (*)(const char *_data, std::size_t _size, std::size_t _from, char _quote);
+
+  inline std::size_t find_quoted_scalar(const char *_data, std::size_t _size, std::size_t _from, char _quote)
+  {
+    for (auto at = _from; at < _size; ++at) {
+      auto c = _data[at];
+      if (c == _quote || c == '\\' || c == '\n' || c == '\r' || c == '\0') return at;
+    }
+    return _size;
+  }
+
+#ifdef YAML_SIMD_X86
+  // structural bytes are matched with two nibble lookups: each high nibble in use gets a class bit, the low nibble
+  // table holds the classes it belongs to and a byte is structural when both lookups share a bit
+  // class 0x01: \0 \t \n \r, 0x02: ' ' '"' '#' '\'' ',', 0x04: ':', 0x08: '[' '\' ']', 0x10: '{' '}'
+#define YAML_LOW_NIBBLES 0x03, 0, 0x02, 0x02, 0, 0, 0, 0x02, 0, 0x01, 0x05, 0x18, 0x0A, 0x19, 0, 0
+#define YAML_HIGH_NIBBLES 0x01, 0, 0x02, 0x04, 0, 0x08, 0, 0x10, 0, 0, 0, 0, 0, 0, 0, 0
+
+  YAML_TARGET("avx2") inline block_masks classify_avx2(const char *_block)
+  {
+    const auto low_table = _mm256_setr_epi8(YAML_LOW_NIBBLES, YAML_LOW_NIBBLES);
+    const auto high_table = _mm256_setr_epi8(YAML_HIGH_NIBBLES, YAML_HIGH_NIBBLES);
+    const auto nibble = _mm256_set1_epi8(0x0F);
+    const auto zero = _mm256_setzero_si256();
+    const auto line_feed = _mm256_set1_epi8('\n');
+    const auto carriage_return = _mm256_set1_epi8('\r');
+
+    auto result = block_masks{};
+    for (auto half = 0; half < 2; ++half) {
+      auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_block + 32 * half));
+      auto low = _mm256_shuffle_epi8(low_table, _mm256_and_si256(chunk, nibble));
+      auto high = _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble));
+      auto other = _mm256_cmpeq_epi8(_mm256_and_si256(low, high), zero);
+      auto breaks = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, line_feed), _mm256_cmpeq_epi8(chunk, carriage_return));
+      auto shift = 32 * half;
+      result.structural |= std::uint64_t{ ~static_cast<std::uint32_t>(_mm256_movemask_epi8(other)) } << shift;
+      result.breaks |= std::uint64_t{ static_cast<std::uint32_t>(_mm256_movemask_epi8(breaks)) } << shift;
+    }
+    return result;
+  }
+
+  YAML_TARGET("sse4.2") inline block_masks classify_sse42(const char *_block)
+  {
+    const auto low_table = _mm_setr_epi8(YAML_LOW_NIBBLES);
+    const auto high_table = _mm_setr_epi8(YAML_HIGH_NIBBLES);
+    const auto nibble = _mm_set1_epi8(0x0F);
+    const auto zero = _mm_setzero_si128();
+    const auto line_feed = _mm_set1_epi8('\n');
+    const auto carriage_return = _mm_set1_epi8('\r');
+
+    auto result = block_masks{};
+    for (auto quarter = 0; quarter < 4; ++quarter) {
+      auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_block + 16 * quarter));
+      auto low = _mm_shuffle_epi8(low_table, _mm_and_si128(chunk, nibble));
+      auto high = _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble));
+      auto other = _mm_cmpeq_epi8(_mm_and_si128(low, high), zero);
+      auto breaks = _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return));
+      auto shift = 16 * quarter;
+      result.structural |= std::uint64_t{ ~static_cast<std::uint32_t>(_mm_movemask_epi8(other)) & 0xFFFFu } << shift;
+      result.breaks |= std::uint64_t{ static_cast<std::uint32_t>(_mm_movemask_epi8(breaks)) } << shift;
+    }
+    return result;
+  }
+
+#undef YAML_LOW_NIBBLES
+#undef YAML_HIGH_NIBBLES
+
+  YAML_TARGET("avx2") inline std::size_t find_quoted_avx2(
+    const char *_data, std::size_t _size, std::size_t _from, char _quote)
+  {
+    const auto quote = _mm256_set1_epi8(_quote);
+    const auto backslash = _mm256_set1_epi8('\\');
+    const auto line_feed = _mm256_set1_epi8('\n');
+    const auto carriage_return = _mm256_set1_epi8('\r');
+    const auto zero = _mm256_setzero_si256();
+    auto at = _from;
+    for (; at + 32 <= _size; at += 32) {
+      auto chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_data + at));
+      auto escapes = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash));
+      auto breaks = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, line_feed), _mm256_cmpeq_epi8(chunk, carriage_return));
+      auto stops = _mm256_or_si256(_mm256_or_si256(escapes, breaks), _mm256_cmpeq_epi8(chunk, zero));
+      if (auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(stops)))
+        return at + static_cast<std::size_t>(std::countr_zero(mask));
+    }
+    return find_quoted_scalar(_data, _size, at, _quote);
+  }
+
+  YAML_TARGET("sse4.2") inline std::size_t find_quoted_sse42(
+    const char *_data, std::size_t _size, std::size_t _from, char _quote)
+  {
+    const auto quote = _mm_set1_epi8(_quote);
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto line_feed = _mm_set1_epi8('\n');
+    const auto carriage_return = _mm_set1_epi8('\r');
+    const auto zero = _mm_setzero_si128();
+    auto at = _from;
+    for (; at + 16 <= _size; at += 16) {
+      auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_data + at));
+      auto escapes = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+      auto breaks = _mm_or_si128(_mm_cmpeq_epi8(chunk, line_feed), _mm_cmpeq_epi8(chunk, carriage_return));
+      auto stops = _mm_or_si128(_mm_or_si128(escapes, breaks), _mm_cmpeq_epi8(chunk, zero));
+      if (auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(stops)))
+        return at + static_cast<std::size_t>(std::countr_zero(mask));
+    }
+    return find_quoted_scalar(_data, _size, at, _quote);
+  }
+#endif
+
+  // instruction sets of the running cpu the kernels use
+  struct features
+  {
+    bool sse42 = false;
+    bool avx2 = false;
+  };
+
+  inline features supported()
+  {
+    auto result = features{};
+#ifdef YAML_SIMD_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    result.sse42 = (info[2] & (1 << 20)) != 0;
+    auto os_avx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    result.avx2 = os_avx && (info[1] & (1 << 5)) != 0;
+#else
+    result.sse42 = __builtin_cpu_supports("sse4.2") != 0;
+    result.avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+#endif
+    return result;
+  }
+
+  // every classifier supported by the running cpu, the widest first
+  inline std::vector<classifier> available()
+  {
+    auto result = std::vector<classifier>{};
+#ifdef YAML_SIMD_X86
+    auto cpu = supported();
+    if (cpu.avx2) result.push_back(classify_avx2);
+    if (cpu.sse42) result.push_back(classify_sse42);
+#endif
+    result.push_back(classify_scalar);
+    return result;
+  }
+
+  inline classifier active()
+  {
+    static const auto selected = available().front();
+    return selected;
+  }
+
+  // every quoted scalar finder supported by the running cpu, the widest first
+  inline std::vector<quoted_finder> quoted_available()
+  {
+    auto result = std::vector<quoted_finder>{};
+#ifdef YAML_SIMD_X86
+    auto cpu = supported();
+    if (cpu.avx2) result.push_back(find_quoted_avx2);
+    if (cpu.sse42) result.push_back(find_quoted_sse42);
+#endif
+    result.push_back(find_quoted_scalar);
+    return result;
+  }
+
+  inline quoted_finder quoted_active()
+  {
+    static const auto selected = quoted_available().front();
+    return selected;
+  }
+
+}// namespace simd
+
+// first scanning stage: the input is classified block by block ahead of the scanner, marking the structural bytes and
+// the line breaks. the scanner then jumps from one structural byte to the next instead of testing every byte of scalar
+// content and comments. classification starts at the block of the first position looked up and only moves forward,
+// the blocks behind the positions looked up are dropped as it goes. looking up an earlier position classifies again.
+class structural_index
+{
+public:
+  structural_index() = default;
+  explicit structural_index(std::string_view _input, std::size_t _from = 0,
+    std::pmr::memory_resource *_resource = std::pmr::get_default_resource())
+    : input(_input), base(_from / 64), structural(_resource), breaks(_resource)
+  {}
+
+  // indexes another input, the classified blocks keep their storage
+  void reset(std::string_view _input, std::size_t _from = 0) noexcept
+  {
+    input = _input;
+    base = _from / 64;
+    structural.clear();
+    breaks.clear();
+  }
+
+  // position of the first structural byte at or after _from, the input size if there is none
+  std::size_t next_structural(std::size_t _from) { return next(structural, _from); }
+  // position of the first line break at or after _from, the input size if there is none
+  std::size_t next_break(std::size_t _from) { return next(breaks, _from); }
+
+private:
+  // blocks classified at once ahead of the scanner
+  static constexpr std::size_t batch = 64;
+
+  std::string_view input;
+  std::size_t base = 0;// first block kept
+  std::pmr::vector<std::uint64_t> structural;
+  std::pmr::vector<std::uint64_t> breaks;
+
+  std::size_t next(const std::pmr::vector<std::uint64_t> &_bits, std::size_t _from)
+  {
+    // the words behind are gone, they are classified again from there
+    if (_from / 64 < base) reset(input, _from);
+    auto word = _from / 64 - base;
+    if (word >= _bits.size() && !extend(word, _from / 64)) return input.size();
+    auto mask = _bits[word] & (~std::uint64_t{ 0 } << (_from % 64));
+    while (!mask) {
+      if (++word >= _bits.size() && !extend(word, _from / 64)) return input.size();
+      mask = _bits[word];
+    }
+    return (base + word) * 64 + static_cast<std::size_t>(std::countr_zero(mask));
+  }
+
+  // classifies the blocks up to _word relative to base, false past the end of the input. the positions asked for
+  // mostly move forward, so the words before the block _kept are dropped first and the memory held stays within a
+  // couple of batches whatever the size of the input. _word is moved along with base
+  bool extend(std::size_t &_word, std::size_t _kept)
+  {
+    if (auto dropped = _kept - base) {
+      if (dropped >= structural.size()) {
+        structural.clear();
+        breaks.clear();
+      } else {
+        structural.erase(structural.begin(), structural.begin() + static_cast<std::ptrdiff_t>(dropped));
+        breaks.erase(breaks.begin(), breaks.begin() + static_cast<std::ptrdiff_t>(dropped));
+      }
+      base = _kept;
+      _word -= dropped;
+    }
+    auto blocks = (input.size() + 63) / 64 - base;
+    if (_word >= blocks) return false;
+    auto first = structural.size();
+    auto last = std::min(blocks, std::max(_word + 1, first + batch));
+    structural.resize(last);
+    breaks.resize(last);
+    auto classify = simd::active();
+    for (auto word = first; word < last; ++word) {
+      auto offset = (base + word) * 64;
+      auto masks = block_masks{};
+      if (offset + 64 <= input.size())
+        masks = classify(input.data() + offset);
+      else {
+        char tail[64] = {};
+        std::memcpy(tail, input.data() + offset, input.size() - offset);
+        masks = classify(tail);
+        // the zero padding past the end is not part of the input
+        masks.structural &= ~std::uint64_t{ 0 } >> (64 - (input.size() - offset));
+      }
+      structural[word] = masks.structural;
+      breaks[word] = masks.breaks;
+    }
+    return true;
+  }
+};
+
+}// namespace yaml::detail
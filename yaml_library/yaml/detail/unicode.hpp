@@ -0,0 +1,347 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <yaml/detail/structural.hpp>
+
+namespace yaml::detail {
+
+// offset of the first byte of the first ill formed sequence of the utf-8 content: overlong encodings, surrogates,
+// code points past U+10FFFF, stray or missing continuation bytes. _size when the content is valid
+inline std::size_t find_invalid_utf8(const char *_data, std::size_t _size) noexcept
+{
+  auto *bytes = reinterpret_cast<const unsigned char *>(_data);
+  for (auto at = std::size_t{ 0 }; at < _size;) {
+    // eight ascii bytes at once
+    auto word = std::uint64_t{ 0 };
+    if (_size - at >= 8 && (std::memcpy(&word, bytes + at, 8), !(word & 0x8080808080808080u))) {
+      at += 8;
+      continue;
+    }
+    auto lead = bytes[at];
+    if (lead < 0x80) {
+      ++at;
+      continue;
+    }
+    auto length = std::size_t{ 0 };
+    auto code = char32_t{};
+    auto least = char32_t{};
+    if ((lead & 0xE0) == 0xC0)
+      length = 2, code = lead & 0x1Fu, least = 0x80;
+    else if ((lead & 0xF0) == 0xE0)
+      length = 3, code = lead & 0x0Fu, least = 0x800;
+    else if ((lead & 0xF8) == 0xF0)
+      length = 4, code = lead & 0x07u, least = 0x10000;
+    else
+      return at;
+    if (_size - at < length) return at;
+    for (auto i = std::size_t{ 1 }; i < length; ++i) {
+      if ((bytes[at + i] & 0xC0) != 0x80) return at;
+      code = (code << 6) | (bytes[at + i] & 0x3Fu);
+    }
+    if (code < least || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) return at;
+    at += length;
+  }
+  return _size;
+}
+
+// writes the utf-8 encoding of a valid code point, returns the end of the output
+inline char *put_utf8(char32_t _code, char *_output) noexcept
+{
+  auto put = [&](unsigned _byte) { *_output++ = static_cast<char>(_byte); };
+  if (_code < 0x80)
+    put(_code);
+  else if (_code < 0x800) {
+    put(0xC0 | (_code >> 6));
+    put(0x80 | (_code & 0x3F));
+  } else if (_code < 0x10000) {
+    put(0xE0 | (_code >> 12));
+    put(0x80 | ((_code >> 6) & 0x3F));
+    put(0x80 | (_code & 0x3F));
+  } else {
+    put(0xF0 | (_code >> 18));
+    put(0x80 | ((_code >> 12) & 0x3F));
+    put(0x80 | ((_code >> 6) & 0x3F));
+    put(0x80 | (_code & 0x3F));
+  }
+  return _output;
+}
+
+namespace simd {
+
+  // the kernels checking utf-8 content and narrowing runs of ascii code units of utf-16 and utf-32 content to bytes.
+  // the narrowing kernels convert whole vectors of ascii units from the start of the input and return the number of
+  // units converted, the transcoder handles the other characters one at a time
+  struct unicode_kernels
+  {
+    bool (*validate)(const char *_data, std::size_t _size);
+    std::size_t (*narrow16)(const char *_input, std::size_t _count, char *_output, bool _big_endian);
+    std::size_t (*narrow32)(const char *_input, std::size_t _count, char *_output, bool _big_endian);
+  };
+
+  inline bool validate_scalar(const char *_data, std::size_t _size)
+  {
+    return find_invalid_utf8(_data, _size) == _size;
+  }
+
+  template<std::size_t Width>
+  std::size_t narrow_scalar(const char *_input, std::size_t _count, char *_output, bool _big_endian)
+  {
+    auto *units = reinterpret_cast<const unsigned char *>(_input);
+    auto done = std::size_t{ 0 };
+    for (; done < _count; ++done, units += Width) {
+      auto low = _big_endian ? units[Width - 1] : units[0];
+      auto high = std::uint32_t{ 0 };
+      for (auto i = std::size_t{ 1 }; i < Width; ++i) high |= _big_endian ? units[i - 1] : units[i];
+      if (high || low >= 0x80) break;
+      _output[done] = static_cast<char>(low);
+    }
+    return done;
+  }
+
+#ifdef YAML_SIMD_X86
+  // utf-8 validation after Keiser and Lemire, "Validating UTF-8 in less than one instruction per byte": the errors of
+  // a pair of consecutive bytes are found with three nibble lookups, each giving the error classes its nibble can be
+  // part of. the third and fourth bytes of a sequence are checked to be continuations from the bytes two and three
+  // places before them. blocks of ascii only check that the previous block did not end inside a sequence
+  namespace utf8_errors {
+
+    constexpr std::uint8_t too_short = 1 << 0;// lead byte followed by a lead or ascii byte
+    constexpr std::uint8_t too_long = 1 << 1;// ascii followed by a continuation
+    constexpr std::uint8_t overlong_3 = 1 << 2;
+    constexpr std::uint8_t too_large = 1 << 3;
+    constexpr std::uint8_t surrogate = 1 << 4;
+    constexpr std::uint8_t overlong_2 = 1 << 5;
+    constexpr std::uint8_t too_large_1000 = 1 << 6;
+    constexpr std::uint8_t overlong_4 = 1 << 6;
+    constexpr std::uint8_t two_continuations = 1 << 7;
+    constexpr std::uint8_t carry = too_short | too_long | two_continuations;
+
+    alignas(16) constexpr std::array<std::uint8_t, 16> first_high = { too_long, too_long, too_long, too_long, too_long,
+      too_long, too_long, too_long, two_continuations, two_continuations, two_continuations, two_continuations,
+      too_short | overlong_2, too_short, too_short | overlong_3 | surrogate,
+      too_short | too_large | too_large_1000 | overlong_4 };
+    alignas(16) constexpr std::array<std::uint8_t, 16> first_low = { carry | overlong_3 | overlong_2 | overlong_4,
+      carry | overlong_2, carry, carry, carry | too_large, carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000, carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000, carry | too_large | too_large_1000, carry | too_large | too_large_1000,
+      carry | too_large | too_large_1000, carry | too_large | too_large_1000 | surrogate,
+      carry | too_large | too_large_1000, carry | too_large | too_large_1000 };
+    alignas(16) constexpr std::array<std::uint8_t, 16> second_high = { too_short, too_short, too_short, too_short,
+      too_short, too_short, too_short, too_short,
+      too_long | overlong_2 | two_continuations | overlong_3 | too_large_1000 | overlong_4,
+      too_long | overlong_2 | two_continuations | overlong_3 | too_large,
+      too_long | overlong_2 | two_continuations | surrogate | too_large,
+      too_long | overlong_2 | two_continuations | surrogate | too_large, too_short, too_short, too_short, too_short };
+
+    // bytes above these at the end of a block start a sequence the next block completes
+    alignas(32) constexpr std::array<std::uint8_t, 32> incomplete = [] {
+      auto result = std::array<std::uint8_t, 32>{};
+      result.fill(0xFF);
+      result[29] = 0xF0 - 1;
+      result[30] = 0xE0 - 1;
+      result[31] = 0xC0 - 1;
+      return result;
+    }();
+
+  }// namespace utf8_errors
+
+  YAML_TARGET("avx2") inline __m256i table_avx2(const std::array<std::uint8_t, 16> &_table)
+  {
+    return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(_table.data())));
+  }
+
+  YAML_TARGET("avx2") inline __m256i utf8_errors_avx2(__m256i _input, __m256i _previous)
+  {
+    const auto nibble = _mm256_set1_epi8(0x0F);
+    auto before = _mm256_permute2x128_si256(_previous, _input, 0x21);
+    auto prev1 = _mm256_alignr_epi8(_input, before, 15);
+    auto prev2 = _mm256_alignr_epi8(_input, before, 14);
+    auto prev3 = _mm256_alignr_epi8(_input, before, 13);
+
+    auto first_high = _mm256_shuffle_epi8(
+      table_avx2(utf8_errors::first_high), _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    auto first_low = _mm256_shuffle_epi8(table_avx2(utf8_errors::first_low), _mm256_and_si256(prev1, nibble));
+    auto second_high = _mm256_shuffle_epi8(
+      table_avx2(utf8_errors::second_high), _mm256_and_si256(_mm256_srli_epi16(_input, 4), nibble));
+    auto special = _mm256_and_si256(_mm256_and_si256(first_high, first_low), second_high);
+
+    // only 111_____ and 1111____ keep their high bit
+    auto third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80));
+    auto fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80));
+    auto continuation = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+    return _mm256_xor_si256(continuation, special);
+  }
+
+  YAML_TARGET("avx2") inline bool validate_avx2(const char *_data, std::size_t _size)
+  {
+    const auto incomplete_limits = _mm256_load_si256(reinterpret_cast<const __m256i *>(utf8_errors::incomplete.data()));
+    auto errors = _mm256_setzero_si256();
+    auto previous = _mm256_setzero_si256();
+    auto incomplete = _mm256_setzero_si256();
+    auto at = std::size_t{ 0 };
+    for (; at + 32 <= _size; at += 32) {
+      auto input = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_data + at));
+      if (!_mm256_movemask_epi8(input))
+        errors = _mm256_or_si256(errors, incomplete);
+      else {
+        errors = _mm256_or_si256(errors, utf8_errors_avx2(input, previous));
+        incomplete = _mm256_subs_epu8(input, incomplete_limits);
+      }
+      previous = input;
+    }
+    // the zero padding ends the sequences left open, an empty tail still checks the last block
+    alignas(32) char tail[32] = {};
+    std::memcpy(tail, _data + at, _size - at);
+    auto input = _mm256_load_si256(reinterpret_cast<const __m256i *>(tail));
+    errors = _mm256_or_si256(errors, utf8_errors_avx2(input, previous));
+    return _mm256_testz_si256(errors, errors);
+  }
+
+  YAML_TARGET("sse4.2") inline __m128i table_sse42(const std::array<std::uint8_t, 16> &_table)
+  {
+    return _mm_load_si128(reinterpret_cast<const __m128i *>(_table.data()));
+  }
+
+  YAML_TARGET("sse4.2") inline __m128i utf8_errors_sse42(__m128i _input, __m128i _previous)
+  {
+    const auto nibble = _mm_set1_epi8(0x0F);
+    auto prev1 = _mm_alignr_epi8(_input, _previous, 15);
+    auto prev2 = _mm_alignr_epi8(_input, _previous, 14);
+    auto prev3 = _mm_alignr_epi8(_input, _previous, 13);
+
+    auto first_high =
+      _mm_shuffle_epi8(table_sse42(utf8_errors::first_high), _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    auto first_low = _mm_shuffle_epi8(table_sse42(utf8_errors::first_low), _mm_and_si128(prev1, nibble));
+    auto second_high =
+      _mm_shuffle_epi8(table_sse42(utf8_errors::second_high), _mm_and_si128(_mm_srli_epi16(_input, 4), nibble));
+    auto special = _mm_and_si128(_mm_and_si128(first_high, first_low), second_high);
+
+    auto third = _mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80));
+    auto fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80));
+    auto continuation = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+    return _mm_xor_si128(continuation, special);
+  }
+
+  YAML_TARGET("sse4.2") inline bool validate_sse42(const char *_data, std::size_t _size)
+  {
+    const auto incomplete_limits =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(utf8_errors::incomplete.data() + 16));
+    auto errors = _mm_setzero_si128();
+    auto previous = _mm_setzero_si128();
+    auto incomplete = _mm_setzero_si128();
+    auto at = std::size_t{ 0 };
+    for (; at + 16 <= _size; at += 16) {
+      auto input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_data + at));
+      if (!_mm_movemask_epi8(input))
+        errors = _mm_or_si128(errors, incomplete);
+      else {
+        errors = _mm_or_si128(errors, utf8_errors_sse42(input, previous));
+        incomplete = _mm_subs_epu8(input, incomplete_limits);
+      }
+      previous = input;
+    }
+    alignas(16) char tail[16] = {};
+    std::memcpy(tail, _data + at, _size - at);
+    auto input = _mm_load_si128(reinterpret_cast<const __m128i *>(tail));
+    errors = _mm_or_si128(errors, utf8_errors_sse42(input, previous));
+    return _mm_testz_si128(errors, errors);
+  }
+
+  // the narrowing kernels swap the bytes of big endian units, test that no bit above the ascii range is set and pack
+  // the low bytes of the units
+  YAML_TARGET("avx2") inline std::size_t narrow16_avx2(
+    const char *_input, std::size_t _count, char *_output, bool _big_endian)
+  {
+    const auto swap = _mm256_setr_epi8(
+      1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    const auto non_ascii = _mm256_set1_epi16(static_cast<short>(0xFF80));
+    auto done = std::size_t{ 0 };
+    for (; done + 16 <= _count; done += 16) {
+      auto units = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_input + 2 * done));
+      if (_big_endian) units = _mm256_shuffle_epi8(units, swap);
+      if (!_mm256_testz_si256(units, non_ascii)) break;
+      auto bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(units, units), 0x08);
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(_output + done), _mm256_castsi256_si128(bytes));
+    }
+    return done;
+  }
+
+  YAML_TARGET("avx2") inline std::size_t narrow32_avx2(
+    const char *_input, std::size_t _count, char *_output, bool _big_endian)
+  {
+    const auto swap = _mm256_setr_epi8(
+      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    const auto non_ascii = _mm256_set1_epi32(static_cast<int>(0xFFFFFF80));
+    const auto order = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+    auto done = std::size_t{ 0 };
+    for (; done + 8 <= _count; done += 8) {
+      auto units = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_input + 4 * done));
+      if (_big_endian) units = _mm256_shuffle_epi8(units, swap);
+      if (!_mm256_testz_si256(units, non_ascii)) break;
+      auto words = _mm256_packus_epi32(units, units);
+      auto bytes = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(words, words), order);
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(_output + done), _mm256_castsi256_si128(bytes));
+    }
+    return done;
+  }
+
+  YAML_TARGET("sse4.2") inline std::size_t narrow16_sse42(
+    const char *_input, std::size_t _count, char *_output, bool _big_endian)
+  {
+    const auto swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    const auto non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    auto done = std::size_t{ 0 };
+    for (; done + 8 <= _count; done += 8) {
+      auto units = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_input + 2 * done));
+      if (_big_endian) units = _mm_shuffle_epi8(units, swap);
+      if (!_mm_testz_si128(units, non_ascii)) break;
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(_output + done), _mm_packus_epi16(units, units));
+    }
+    return done;
+  }
+
+  YAML_TARGET("sse4.2") inline std::size_t narrow32_sse42(
+    const char *_input, std::size_t _count, char *_output, bool _big_endian)
+  {
+    const auto swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    const auto non_ascii = _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+    auto done = std::size_t{ 0 };
+    for (; done + 4 <= _count; done += 4) {
+      auto units = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_input + 4 * done));
+      if (_big_endian) units = _mm_shuffle_epi8(units, swap);
+      if (!_mm_testz_si128(units, non_ascii)) break;
+      auto words = _mm_packus_epi32(units, units);
+      auto bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+      std::memcpy(_output + done, &bytes, 4);
+    }
+    return done;
+  }
+#endif
+
+  // every set of unicode kernels supported by the running cpu, the widest first
+  inline std::vector<unicode_kernels> unicode_available()
+  {
+    auto result = std::vector<unicode_kernels>{};
+#ifdef YAML_SIMD_X86
+    auto cpu = supported();
+    if (cpu.avx2) result.push_back({ validate_avx2, narrow16_avx2, narrow32_avx2 });
+    if (cpu.sse42) result.push_back({ validate_sse42, narrow16_sse42, narrow32_sse42 });
+#endif
+    result.push_back({ validate_scalar, narrow_scalar<2>, narrow_scalar<4> });
+    return result;
+  }
+
+  inline const unicode_kernels &unicode_active()
+  {
+    static const auto selected = unicode_available().front();
+    return selected;
+  }
+
+}// namespace simd
+}// namespace yaml::detail
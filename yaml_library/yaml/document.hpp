@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace yaml {
+
+// owns every node of a tree in a monotonic arena, nodes are referenced by plain pointers and released all at once
+// when the document goes away. nodes must be trivially destructible since their destructor is never run.
+// scalars may still view the loaded content, the caller keeps it alive for the lifetime of the document unless the
+// document holds it.
+template<typename Node> class document
+{
+public:
+  using node_type = Node;
+
+  document() : arena(std::make_unique<std::pmr::monotonic_buffer_resource>()) {}
+  explicit document(std::size_t _initial_size)
+    : arena(std::make_unique<std::pmr::monotonic_buffer_resource>(_initial_size))
+  {}
+  // the arena takes its blocks from _upstream which outlives the document
+  explicit document(std::pmr::memory_resource &_upstream)
+    : arena(std::make_unique<std::pmr::monotonic_buffer_resource>(&_upstream))
+  {}
+
+  document(document &&) noexcept = default;
+  document &operator=(document &&) noexcept = default;
+
+  Node &root() noexcept { return *top; }
+  const Node &root() const noexcept { return *top; }
+  Node &operator*() noexcept { return *top; }
+  const Node &operator*() const noexcept { return *top; }
+  Node *operator->() noexcept { return top; }
+  const Node *operator->() const noexcept { return top; }
+
+  void set_root(Node *_root) noexcept { top = _root; }
+
+  // drops every node, the arena hands its blocks back to its upstream resource
+  void clear() noexcept
+  {
+    arena->release();
+    top = nullptr;
+    content.reset();
+  }
+
+  // makes the document own the content its scalars view
+  void hold(std::shared_ptr<const void> _content) noexcept { content = std::move(_content); }
+
+  std::pmr::memory_resource &resource() noexcept { return *arena; }
+
+  template<typename... Args> Node *create(Args &&..._args)
+  {
+    static_assert(std::is_trivially_destructible_v<Node>);
+    return std::construct_at(static_cast<Node *>(arena->allocate(sizeof(Node), alignof(Node))),
+      std::forward<Args>(_args)...);
+  }
+
+  // copies a contiguous range into the arena
+  template<typename T> std::span<T> copy(std::span<const T> _items)
+  {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+    if (_items.empty()) return {};
+    auto *data = static_cast<T *>(arena->allocate(_items.size_bytes(), alignof(T)));
+    std::uninitialized_copy(_items.begin(), _items.end(), data);
+    return { data, _items.size() };
+  }
+
+  std::string_view copy(std::string_view _content)
+  {
+    if (_content.empty()) return {};
+    auto *data = static_cast<char *>(arena->allocate(_content.size(), 1));
+    std::ranges::copy(_content, data);
+    return { data, _content.size() };
+  }
+
+private:
+  // the arena is boxed so that node addresses and the resource survive moves of the document
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;
+  Node *top = nullptr;
+  std::shared_ptr<const void> content;
+};
+
+}// namespace yaml
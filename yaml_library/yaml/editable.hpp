@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <yaml/detail/composer.hpp>
+#include <yaml/detail/splitter.hpp>
+#include <yaml/detail/structural.hpp>
+#include <yaml/document.hpp>
+#include <yaml/error.hpp>
+#include <yaml/yaml.hpp>
+
+namespace yaml {
+namespace detail {
+
+  // forwards to the default resource and keeps the size of the blocks it handed out and still holds
+  class measured_resource : public std::pmr::memory_resource
+  {
+  public:
+    std::size_t held = 0;
+
+  private:
+    void *do_allocate(std::size_t _bytes, std::size_t _alignment) override
+    {
+      auto *result = std::pmr::get_default_resource()->allocate(_bytes, _alignment);
+      held += _bytes;
+      return result;
+    }
+
+    void do_deallocate(void *_pointer, std::size_t _bytes, std::size_t _alignment) override
+    {
+      std::pmr::get_default_resource()->deallocate(_pointer, _bytes, _alignment);
+      held -= _bytes;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &_other) const noexcept override { return this == &_other; }
+  };
+
+}// namespace detail
+
+// replaces length bytes of the content at offset by text
+struct text_edit
+{
+  std::size_t offset = 0;
+  std::size_t length = 0;
+  std::string_view text;
+};
+
+// a document kept in sync with edits of its content. the top level block collection is split into segments on the
+// lines starting its entries at the first column, each segment is composed on its own into the arena of the document.
+// an edit re-parses the segments it touches only: their text with the edit applied is split again, composed, and its
+// entries replace theirs in the root collection. the nodes of the other segments are kept with their storage.
+// the whole content is reloaded, which also reports the errors, when an edit reaches the lines before the first entry
+// or when the edited segments do not compose on their own: aliases to anchors of other segments, quoted scalars or
+// flow collections spanning an entry line. a document whose root is not a block collection, or whose segments do not
+// compose on their own, is reloaded on every edit. the entries of the root collection are kept out of the arena and
+// spliced in place. the text edited out and the nodes replaced stay in the arena until a reload, the whole content is
+// reloaded once they make the arena twice the size it had after the last reload, which also renews every node.
+template<schematic Schema = failsafe> class editable_document
+{
+public:
+  using node = typename Schema::node;
+  using node_ref = node *;
+
+  explicit editable_document(std::string_view _content, Schema _schema = {})
+    : schema(std::move(_schema)), upstream(std::make_unique<detail::measured_resource>()), tree(*upstream)
+  {
+    reload(_content);
+  }
+
+  const node &root() const noexcept { return *tree; }
+  const node &operator*() const noexcept { return *tree; }
+  const node *operator->() const noexcept { return &*tree; }
+
+  std::size_t size() const noexcept { return length; }
+
+  // bytes of the blocks the arena holds
+  std::size_t arena_size() const noexcept { return upstream->held; }
+
+  std::string content() const
+  {
+    auto result = std::string{ header };
+    result.reserve(length);
+    for (auto &part : segments) result += part.text;
+    return result;
+  }
+
+  // nodes of the segments left untouched stay valid unless the edit reloads the whole content. when the edited
+  // content is ill formed the error is thrown and the document is left unchanged
+  void apply(const text_edit &_edit)
+  {
+    if (_edit.offset > length || _edit.length > length - _edit.offset)
+      throw std::out_of_range("edit beyond the end of the content");
+    if (segments.empty() || _edit.offset <= segments.front().begin) return reload(edited(_edit));
+
+    // indented text inserted at the start of a segment continues the previous one, a line break removed at the end
+    // of a segment joins the next one
+    auto first = find(_edit.offset - 1);
+    auto last = find(std::min(_edit.offset + _edit.length, length - 1));
+    auto text = std::string{};
+    for (auto i = first; i <= last; ++i) text += segments[i].text;
+    text.replace(_edit.offset - segments[first].begin, _edit.length, _edit.text);
+
+    auto stored = tree.copy(text);
+    auto replaced = std::span<const segment>{ segments }.subspan(first, last - first + 1);
+    auto budget = schema.max_alias_expansion - expanded;
+    for (auto &part : replaced) budget += part.expansion;
+    auto parts = std::optional<composed>{};
+    if (detail::is_entry_line(stored, 0, sequence)) {
+      parts = compose(tree, split(stored), replaced.front().begin, replaced.front().first_child, budget);
+      if (!parts) parts = compose(tree, { stored }, replaced.front().begin, replaced.front().first_child, budget);
+    }
+    if (!parts) return reload(edited(_edit));
+
+    auto removed = replaced.back().first_child + replaced.back().children - replaced.front().first_child;
+    auto added = std::size_t{ 0 };
+    for (auto &part : parts->segments) {
+      added += part.children;
+      expanded += part.expansion;
+    }
+    for (auto &part : replaced) expanded -= part.expansion;
+    replace_entries(tree, entry_storage, replaced.front().first_child, removed, parts->roots);
+
+    if (parts->segments.size() == replaced.size())
+      std::ranges::copy(parts->segments, segments.begin() + static_cast<std::ptrdiff_t>(first));
+    else {
+      auto at = segments.erase(segments.begin() + static_cast<std::ptrdiff_t>(first),
+        segments.begin() + static_cast<std::ptrdiff_t>(last + 1));
+      segments.insert(at, parts->segments.begin(), parts->segments.end());
+    }
+    // sizes wrap around when they shrink
+    for (auto i = first + parts->segments.size(); i < segments.size(); ++i) {
+      segments[i].begin += _edit.text.size() - _edit.length;
+      segments[i].first_child += added - removed;
+    }
+    length += _edit.text.size() - _edit.length;
+    if (upstream->held > 2 * reloaded_size + min_garbage) reload(content());
+  }
+
+private:
+  struct segment
+  {
+    std::size_t begin = 0;// offset in the content
+    std::string_view text;
+    std::size_t first_child = 0;// position of its first entry in the root collection
+    std::size_t children = 0;
+    std::size_t expansion = 0;// nodes visited through its aliases
+  };
+
+  // entries of the root collection, the root node views the vector of its kind
+  struct root_entries
+  {
+    std::vector<node_ref> items;
+    std::vector<std::pair<node_ref, node_ref>> pairs;
+  };
+
+  struct composed
+  {
+    std::vector<segment> segments;
+    std::vector<node_ref> roots;
+  };
+
+  // segments gather entries up to this size, which bounds the text an edit re-parses while keeping the cost of
+  // composing each segment on its own low
+  static constexpr std::size_t segment_size = 256;
+  // garbage the arena may gather beyond doubling before a reload, so that small documents are not reloaded all along
+  static constexpr std::size_t min_garbage = 64 * 1024;
+
+  Schema schema;
+  // boxed so that the arena keeps its upstream when the document moves
+  std::unique_ptr<detail::measured_resource> upstream;
+  document<node> tree;
+  root_entries entry_storage;
+  std::size_t reloaded_size = 0;// held by the arena after the last reload
+  // the content before the first entry, the whole content when it is not split
+  std::string_view header;
+  std::vector<segment> segments;
+  bool sequence = false;
+  std::size_t length = 0;
+  std::size_t expanded = 0;
+
+  void reload(std::string_view _content)
+  {
+    auto loaded = document<node>{ *upstream };
+    auto loaded_entries = root_entries{};
+    auto text = loaded.copy(_content);
+    auto root = detail::find_block_root(text);
+    auto parts = std::optional<composed>{};
+    if (root) {
+      auto budget = schema.max_alias_expansion;
+      auto previous = std::exchange(sequence, root->sequence);
+      if (sequence)
+        loaded.set_root(loaded.create(typename Schema::sequence{}));
+      else
+        loaded.set_root(loaded.create(typename Schema::mapping{}));
+      parts = compose(loaded, split(text.substr(root->body)), root->body, 0, budget);
+      // the document is unchanged when the content fails to load
+      if (!parts) sequence = previous;
+    }
+    if (parts) {
+      replace_entries(loaded, loaded_entries, 0, 0, parts->roots);
+      header = text.substr(0, root->body);
+      segments = std::move(parts->segments);
+    } else {
+      loaded = document<node>{ *upstream };
+      text = loaded.copy(_content);
+      auto budget = schema.max_alias_expansion;
+      loaded.set_root(detail::compose_document(schema, loaded, text, budget));
+      header = text;
+      segments.clear();
+    }
+    tree = std::move(loaded);
+    entry_storage = std::move(loaded_entries);
+    reloaded_size = upstream->held;
+    length = _content.size();
+    expanded = 0;
+    for (auto &part : segments) expanded += part.expansion;
+  }
+
+  std::string edited(const text_edit &_edit) const
+  {
+    auto result = content();
+    result.replace(_edit.offset, _edit.length, _edit.text);
+    return result;
+  }
+
+  std::size_t find(std::size_t _offset) const
+  {
+    auto found = std::ranges::upper_bound(segments, _offset, {}, &segment::begin);
+    return static_cast<std::size_t>(found - segments.begin()) - 1;
+  }
+
+  // the text split before entry lines into segments of at least segment_size bytes, the text starts with one
+  std::vector<std::string_view> split(std::string_view _text) const
+  {
+    auto result = std::vector<std::string_view>{};
+    auto index = detail::structural_index{ _text };
+    auto start = std::size_t{ 0 };
+    for (auto at = detail::next_line(_text, index, 0); at < _text.size(); at = detail::next_line(_text, index, at))
+      if (at - start >= segment_size && detail::is_entry_line(_text, at, sequence)) {
+        result.push_back(_text.substr(start, at - start));
+        start = at;
+      }
+    result.push_back(_text.substr(start));
+    return result;
+  }
+
+  // composes each text on its own, none when one of them is not a collection of the root kind
+  std::optional<composed> compose(document<node> &_tree, const std::vector<std::string_view> &_texts,
+    std::size_t _begin, std::size_t _first_child, std::size_t &_budget) const
+  {
+    auto result = composed{};
+    auto budget = _budget;
+    for (auto text : _texts) {
+      if (detail::has_marker(text)) return std::nullopt;
+      auto before = budget;
+      auto *root = node_ref{};
+      try {
+        root = detail::compose_document(schema, _tree, text, budget);
+      } catch (const parse_error &) {
+        return std::nullopt;
+      }
+      auto children = entries(*root);
+      if (!children) return std::nullopt;
+      result.segments.push_back(segment{ _begin, text, _first_child, *children, before - budget });
+      result.roots.push_back(root);
+      _begin += text.size();
+      _first_child += *children;
+    }
+    _budget = budget;
+    return result;
+  }
+
+  // number of entries of a collection of the root kind
+  std::optional<std::size_t> entries(const node &_node) const
+  {
+    if (sequence) {
+      if (auto *items = std::get_if<typename Schema::sequence>(&_node.data)) return items->size();
+    } else if (auto *pairs = std::get_if<typename Schema::mapping>(&_node.data))
+      return pairs->size();
+    return std::nullopt;
+  }
+
+  // replaces _count entries of the root collection from _first by the entries of the collections _roots, the entries
+  // after them are moved in place
+  void replace_entries(document<node> &_tree, root_entries &_entries, std::size_t _first, std::size_t _count,
+    std::span<const node_ref> _roots) const
+  {
+    auto replace = [&]<typename Collection>(Collection, std::vector<typename Collection::element_type> &_storage) {
+      auto incoming = std::vector<typename Collection::element_type>{};
+      for (auto *part : _roots) std::ranges::copy(std::get<Collection>(part->data), std::back_inserter(incoming));
+      // the entries in common are overwritten, the others inserted or erased
+      auto common = static_cast<std::ptrdiff_t>(std::min(_count, incoming.size()));
+      auto at = std::ranges::copy_n(incoming.begin(), common, _storage.begin() + static_cast<std::ptrdiff_t>(_first)).out;
+      if (incoming.size() > _count)
+        _storage.insert(at, incoming.begin() + common, incoming.end());
+      else
+        _storage.erase(at, at + (static_cast<std::ptrdiff_t>(_count) - common));
+      _tree->data = Collection{ _storage.data(), _storage.size() };
+    };
+    if (sequence)
+      replace(typename Schema::sequence{}, _entries.items);
+    else
+      replace(typename Schema::mapping{}, _entries.pairs);
+  }
+};
+
+}// namespace yaml
@@ -0,0 +1,649 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <yaml/core.hpp>
+#include <yaml/detail/scanner.hpp>
+#include <yaml/event.hpp>
+
+namespace yaml {
+
+struct emit_options
+{
+  // writes every collection in flow style, otherwise the style of the events is kept
+  bool flow = false;
+  // spaces added for the children of a block mapping
+  std::size_t indent = 2;
+};
+
+namespace detail {
+
+  constexpr bool is_indicator(char _c)
+  {
+    switch (_c) {
+    case '-':
+    case '?':
+    case ':':
+    case ',':
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+    case '#':
+    case '&':
+    case '*':
+    case '!':
+    case '|':
+    case '>':
+    case '\'':
+    case '"':
+    case '%':
+    case '@':
+    case '`': return true;
+    default: return false;
+    }
+  }
+
+  constexpr bool is_control(char _c) { return static_cast<unsigned char>(_c) < 0x20 || _c == 0x7f; }
+
+  // characters a plain scalar has to look at more closely, most scalars never meet one
+  inline constexpr auto plain_special = [] {
+    auto result = std::array<bool, 256>{};
+    for (auto c = 0; c < 256; ++c)
+      result[static_cast<std::size_t>(c)] = is_control(static_cast<char>(c)) || c == ':' || c == '#' || is_flow_indicator(static_cast<char>(c));
+    return result;
+  }();
+
+  // whether the scalar reads back unchanged when written plain, conservative with respect to the spec
+  constexpr bool allows_plain(std::string_view _value, bool _flow)
+  {
+    if (_value.empty() || is_blank(_value.front()) || is_blank(_value.back())) return false;
+    if (auto head = _value.substr(0, 3); head == "---" || head == "..." || head == "\xEF\xBB\xBF") return false;
+    auto follows = [&](std::size_t _at) {
+      return _at < _value.size() && !is_blank(_value[_at]) && !(_flow && is_flow_indicator(_value[_at]));
+    };
+    // a leading colon or question mark is always an indicator in flow collections
+    auto first = _value.front();
+    auto leads = first == '-' || ((first == '?' || first == ':') && !_flow);
+    if (is_indicator(first) && !(leads && follows(1))) return false;
+    for (auto at = std::size_t{ 0 }; at < _value.size(); ++at) {
+      auto c = _value[at];
+      if (!plain_special[static_cast<unsigned char>(c)]) continue;
+      if (is_control(c) || (_flow && is_flow_indicator(c))) return false;
+      if (c == ':' && !follows(at + 1)) return false;
+      if (c == '#' && at > 0 && is_blank(_value[at - 1])) return false;
+    }
+    return true;
+  }
+
+  constexpr bool allows_single_quotes(std::string_view _value)
+  {
+    for (auto c : _value)
+      if (c != '\t' && is_control(c)) return false;
+    return true;
+  }
+
+  // literal block scalars need content lines, printable characters and no leading space deciding the indentation
+  constexpr bool allows_literal(std::string_view _value)
+  {
+    auto first = _value.find_first_not_of('\n');
+    if (first == std::string_view::npos || _value[first] == ' ' || _value.front() == ' ') return false;
+    for (auto c : _value)
+      if (c != '\n' && c != '\t' && is_control(c)) return false;
+    return true;
+  }
+
+  // strings of a tree written plain when they load back as strings, empty strings are always quoted
+  template<typename Node> struct string_rules
+  {
+    static bool plain(std::string_view _value) noexcept { return !_value.empty(); }
+  };
+  template<> struct string_rules<core::node>
+  {
+    static bool plain(std::string_view _value) { return std::holds_alternative<core::scalar>(core::classify(_value)); }
+  };
+  template<> struct string_rules<json::node>
+  {
+    static bool plain(std::string_view) noexcept { return false; }
+  };
+
+}// namespace detail
+
+// writes yaml from events or from trees. the output is gathered in a buffer reused for the whole emitter and handed to
+// the sink in large chunks, flush() hands the rest. events follow the order produced by the parser, their scalar and
+// collection styles are kept when the content allows it, otherwise the closest style able to hold the content is used.
+class emitter
+{
+public:
+  // receives the output chunk by chunk
+  using sink = std::function<void(std::string_view)>;
+
+  static constexpr std::size_t chunk_size = 64 * 1024;
+
+  explicit emitter(sink _sink, emit_options _options = {}) : output(std::move(_sink)), options(_options)
+  {
+    buffer.resize(chunk_size + 1024);
+  }
+
+  template<std::output_iterator<char> Out>
+  explicit emitter(Out _out, emit_options _options = {})
+    : emitter(sink{ [_out](std::string_view _chunk) mutable { _out = std::ranges::copy(_chunk, _out).out; } }, _options)
+  {}
+
+  explicit emitter(std::ostream &_output, emit_options _options = {})
+    : emitter(sink{ [&_output](std::string_view _chunk) {
+                _output.write(_chunk.data(), static_cast<std::streamsize>(_chunk.size()));
+              } },
+        _options)
+  {}
+
+  // writes to a file descriptor without taking ownership of it
+  explicit emitter(int _descriptor, emit_options _options = {})
+    : emitter(sink{ [_descriptor](std::string_view _chunk) {
+                while (!_chunk.empty()) {
+#ifdef _WIN32
+                  auto count = ::_write(_descriptor, _chunk.data(), static_cast<unsigned>(_chunk.size()));
+#else
+                  auto count = ::write(_descriptor, _chunk.data(), _chunk.size());
+#endif
+                  if (count >= 0)
+                    _chunk.remove_prefix(static_cast<std::size_t>(count));
+                  else if (errno != EINTR)
+                    throw std::system_error(errno, std::generic_category(), "cannot write the yaml stream");
+                }
+              } },
+        _options)
+  {}
+
+  emitter(const emitter &) = delete;
+  emitter &operator=(const emitter &) = delete;
+
+  void emit(const event &_event)
+  {
+    if (opening) {
+      auto start = *std::exchange(opening, std::nullopt);
+      if (_event.type == event_type::sequence_end || _event.type == event_type::mapping_end) {
+        open_inline(start, false);
+        token(start.type == event_type::mapping_start ? "{}" : "[]");
+        close_node();
+        return;
+      }
+      open_block(start);
+    }
+
+    switch (_event.type) {
+    case event_type::stream_start: break;
+    case event_type::stream_end: flush(); break;
+    case event_type::document_start:
+      if (!_event.value.empty()) {
+        put("%YAML ");
+        put(_event.value);
+        put('\n');
+      }
+      marker = documents > 0 || !_event.implicit || !_event.value.empty();
+      if (marker) put("---");
+      gap = marker;
+      fresh = !marker;
+      break;
+    case event_type::document_end:
+      // nodes never end their last line, block scalars rely on it for their final line break
+      put('\n');
+      if (!_event.implicit) put("...\n");
+      ++documents;
+      marker = false;
+      break;
+    case event_type::alias:
+      open_inline(_event, false);
+      token("*");
+      put(_event.anchor);
+      // the colon would be read as part of the alias
+      if (in_key()) put(' ');
+      close_node();
+      break;
+    case event_type::scalar: write_scalar(_event); break;
+    case event_type::sequence_start:
+    case event_type::mapping_start:
+      if (options.flow || _event.flow || (!levels.empty() && levels.back().flow)) {
+        open_inline(_event, true);
+        token(_event.type == event_type::mapping_start ? "{" : "[");
+        gap = false;
+        levels.push_back(level{ .mapping = _event.type == event_type::mapping_start, .flow = true });
+      } else
+        opening = _event;
+      break;
+    case event_type::sequence_end:
+    case event_type::mapping_end: {
+      auto done = levels.back();
+      levels.pop_back();
+      if (done.flow) put(done.mapping ? '}' : ']');
+      close_node();
+      break;
+    }
+    }
+    if (used >= chunk_size) flush();
+  }
+
+  // writes a document holding the tree, shared collections are written once with an anchor and then as aliases
+  template<typename Node> void dump(const Node &_root)
+  {
+    emit(event{ .type = event_type::document_start, .implicit = true });
+    auto anchors = shared(_root);
+    auto frames = std::vector<frame<Node>>{};
+    walk(_root, frames, anchors);
+    while (!frames.empty()) {
+      auto &top = frames.back();
+      if (top.next == top.size) {
+        emit(event{ .type = top.mapping ? event_type::mapping_end : event_type::sequence_end });
+        frames.pop_back();
+      } else {
+        auto at = top.next++;
+        walk(*top.child(at), frames, anchors);
+      }
+    }
+    emit(event{ .type = event_type::document_end, .implicit = true });
+  }
+
+  void flush()
+  {
+    if (used == 0) return;
+    output({ buffer.data(), used });
+    used = 0;
+  }
+
+private:
+  struct level
+  {
+    bool mapping = false;
+    bool flow = false;
+    bool explicit_key = false;
+    std::size_t indent = 0;
+    std::size_t count = 0;// nodes written, keys and values alike
+  };
+
+  template<typename Node> struct frame
+  {
+    std::variant<std::span<Node *const>, std::span<const std::pair<Node *, Node *>>> children;
+    bool mapping = false;
+    std::size_t next = 0;
+    std::size_t size = 0;
+
+    const Node *child(std::size_t _at) const
+    {
+      if (mapping) {
+        auto &pair = std::get<1>(children)[_at / 2];
+        return _at % 2 ? pair.second : pair.first;
+      }
+      return std::get<0>(children)[_at];
+    }
+  };
+
+  // anchors of the shared collections, empty until the first time they are written
+  template<typename Node> using anchor_names = std::unordered_map<const Node *, std::string>;
+
+  sink output;
+  emit_options options;
+  std::string buffer;// written up to used, grown for the events larger than a chunk
+  std::size_t used = 0;
+  std::vector<level> levels;
+  std::optional<event> opening;// block collection written once its first child or its end is known
+  std::size_t documents = 0;
+  std::size_t anchored = 0;// anchors named by dump
+  bool marker = false;// the current document started with ---
+  bool fresh = true;// a block entry can start here without a line break
+  bool gap = false;// a space separates the next token
+
+  bool in_key() const noexcept { return !levels.empty() && levels.back().mapping && levels.back().count % 2 == 0; }
+
+  // appends through a raw cursor, the buffer only grows when a single event outgrows it
+  char *reserve(std::size_t _size)
+  {
+    if (used + _size > buffer.size()) buffer.resize(std::max(buffer.size() * 2, used + _size));
+    return buffer.data() + used;
+  }
+
+  void put(std::string_view _text)
+  {
+    std::memcpy(reserve(_text.size()), _text.data(), _text.size());
+    used += _text.size();
+  }
+
+  void put(char _c)
+  {
+    *reserve(1) = _c;
+    ++used;
+  }
+
+  void pad(std::size_t _count)
+  {
+    std::memset(reserve(_count), ' ', _count);
+    used += _count;
+  }
+
+  void newline(std::size_t _indent)
+  {
+    put('\n');
+    pad(_indent);
+    gap = false;
+  }
+
+  void token(std::string_view _text)
+  {
+    if (gap) put(' ');
+    put(_text);
+    gap = false;
+    fresh = false;
+  }
+
+  void indicator(char _c)
+  {
+    token(std::string_view{ &_c, 1 });
+    gap = true;
+  }
+
+  void properties(const event &_event)
+  {
+    if (!_event.anchor.empty() && _event.type != event_type::alias) {
+      token("&");
+      put(_event.anchor);
+      gap = true;
+    }
+    if (_event.tag.empty()) return;
+    constexpr auto prefix = std::string_view{ "tag:yaml.org,2002:" };
+    if (_event.tag.starts_with(prefix)) {
+      token("!!");
+      put(_event.tag.substr(prefix.size()));
+    } else if (_event.tag.starts_with('!')) {
+      token(_event.tag);
+    } else {
+      token("!<");
+      put(_event.tag);
+      put('>');
+    }
+    gap = true;
+  }
+
+  // writes what precedes a node kept on the current line: separators, entry and key indicators
+  void open_inline(const event &_event, bool _complex)
+  {
+    if (levels.empty()) {
+      properties(_event);
+      return;
+    }
+    auto &parent = levels.back();
+    auto key = parent.mapping && parent.count % 2 == 0;
+    if (parent.flow) {
+      if (parent.count > 0 && (!parent.mapping || key)) indicator(',');
+      if (key && _complex) indicator('?');
+      if (parent.mapping && !key) indicator(':');
+    } else if (parent.mapping) {
+      if (key) {
+        if (!fresh) newline(parent.indent);
+        if (_complex) {
+          indicator('?');
+          parent.explicit_key = true;
+        }
+      } else {
+        if (parent.explicit_key && !fresh) newline(parent.indent);
+        indicator(':');
+      }
+    } else {
+      if (!fresh) newline(parent.indent);
+      indicator('-');
+    }
+    properties(_event);
+  }
+
+  // writes what precedes a block collection and enters it
+  void open_block(const event &_event)
+  {
+    auto indent = std::size_t{ 0 };
+    auto compact = true;
+    if (!levels.empty()) {
+      auto &parent = levels.back();
+      if (parent.mapping && parent.count % 2 == 1) {
+        indent = parent.indent + options.indent;
+        compact = false;
+      } else
+        indent = parent.indent + 2;
+    }
+    open_inline(_event, true);
+    if (levels.empty()) compact = !marker;
+    if (!compact || !_event.anchor.empty() || !_event.tag.empty()) newline(indent);
+    fresh = true;
+    levels.push_back(level{ .mapping = _event.type == event_type::mapping_start, .indent = indent });
+  }
+
+  void close_node()
+  {
+    fresh = false;
+    if (levels.empty()) return;
+    auto &parent = levels.back();
+    ++parent.count;
+    if (parent.mapping && parent.count % 2 == 0) parent.explicit_key = false;
+  }
+
+  void write_scalar(const event &_event)
+  {
+    auto value = _event.value;
+    auto flow = options.flow || (!levels.empty() && levels.back().flow);
+    auto key = !levels.empty() && levels.back().mapping && levels.back().count % 2 == 0;
+    // plain scalars keep their resolution, others are written quoted unless tagged
+    auto plain = _event.implicit || !_event.tag.empty();
+    auto style = _event.style;
+    if (style == scalar_style::literal || style == scalar_style::folded) {
+      if (flow || key || !detail::allows_literal(value)) style = plain ? scalar_style::plain : scalar_style::double_quoted;
+    }
+    if (style == scalar_style::plain) {
+      auto empty = value.empty() && !flow && !key && (!levels.empty() || marker);
+      if (!plain || (!empty && !detail::allows_plain(value, flow))) style = scalar_style::single_quoted;
+    }
+    if (style == scalar_style::single_quoted && (value.find('\n') != std::string_view::npos || !detail::allows_single_quotes(value)))
+      style = scalar_style::double_quoted;
+
+    auto complex = key && value.size() > 1024;
+    open_inline(_event, complex);
+    switch (style) {
+    case scalar_style::plain:
+      if (!value.empty()) token(value);
+      break;
+    case scalar_style::single_quoted: write_single_quoted(value); break;
+    case scalar_style::double_quoted: write_double_quoted(value); break;
+    case scalar_style::literal:
+    case scalar_style::folded: write_literal(value); break;
+    }
+    close_node();
+  }
+
+  void write_single_quoted(std::string_view _value)
+  {
+    token("'");
+    for (auto c : _value) {
+      put(c);
+      if (c == '\'') put('\'');
+    }
+    put('\'');
+  }
+
+  void write_double_quoted(std::string_view _value)
+  {
+    token("\"");
+    for (auto c : _value) {
+      switch (c) {
+      case '"': put("\\\""); break;
+      case '\\': put("\\\\"); break;
+      case '\n': put("\\n"); break;
+      case '\t': put("\\t"); break;
+      case '\r': put("\\r"); break;
+      case '\0': put("\\0"); break;
+      default:
+        if (detail::is_control(c)) {
+          constexpr auto digits = std::string_view{ "0123456789ABCDEF" };
+          auto code = static_cast<unsigned char>(c);
+          put("\\x");
+          put(digits[code >> 4]);
+          put(digits[code & 0xf]);
+        } else
+          put(c);
+      }
+    }
+    put('"');
+  }
+
+  // the content is indented one level deeper than its parent, the chomping indicator keeps the final line breaks
+  void write_literal(std::string_view _value)
+  {
+    auto indent = options.indent;
+    if (!levels.empty()) indent = levels.back().indent + (levels.back().mapping ? options.indent : 2);
+    auto trailing = _value.size() - (_value.find_last_not_of('\n') + 1);
+    token(trailing == 0 ? "|-" : trailing == 1 ? "|" : "|+");
+    if (trailing > 0) _value.remove_suffix(1);
+    for (auto first = std::size_t{ 0 };;) {
+      auto end = _value.find('\n', first);
+      auto line = _value.substr(first, end - first);
+      put('\n');
+      if (!line.empty()) {
+        pad(indent);
+        put(line);
+      }
+      if (end == std::string_view::npos) break;
+      first = end + 1;
+    }
+    gap = false;
+  }
+
+  // collections reached more than once, the traversal does not enter a collection twice
+  template<typename Node> static anchor_names<Node> shared(const Node &_root)
+  {
+    auto visits = std::unordered_map<const Node *, std::size_t>{};
+    auto result = anchor_names<Node>{};
+    auto pending = std::vector<const Node *>{ &_root };
+    while (!pending.empty()) {
+      auto *node = pending.back();
+      pending.pop_back();
+      std::visit(
+        [&]<typename Data>(const Data &_data) {
+          if constexpr (std::is_same_v<Data, std::span<Node *>> || std::is_same_v<Data, std::span<std::pair<Node *, Node *>>>) {
+            if (++visits[node] > 1) {
+              result.try_emplace(node);
+              return;
+            }
+            for (auto &child : _data) {
+              if constexpr (std::is_same_v<Data, std::span<Node *>>)
+                pending.push_back(child);
+              else {
+                pending.push_back(child.first);
+                pending.push_back(child.second);
+              }
+            }
+          }
+        },
+        node->data);
+    }
+    return result;
+  }
+
+  template<typename Node> void walk(const Node &_node, std::vector<frame<Node>> &_frames, anchor_names<Node> &_anchors)
+  {
+    if constexpr (requires { _node.resolve(); }) _node.resolve();
+    auto found = _anchors.find(&_node);
+    if (found != _anchors.end() && !found->second.empty()) {
+      emit(event{ .type = event_type::alias, .anchor = found->second });
+      return;
+    }
+    auto anchor = std::string_view{};
+    if (found != _anchors.end()) {
+      found->second = "id" + std::to_string(++anchored);
+      anchor = found->second;
+    }
+
+    std::visit(
+      [&]<typename Data>(const Data &_data) {
+        auto scalar = [&](std::string_view _value, bool _implicit, scalar_style _style = scalar_style::plain) {
+          emit(event{ .type = event_type::scalar, .style = _style, .implicit = _implicit, .anchor = anchor, .value = _value });
+        };
+        if constexpr (std::is_same_v<Data, std::span<Node *>>) {
+          emit(event{ .type = event_type::sequence_start, .implicit = true, .anchor = anchor });
+          _frames.push_back(frame<Node>{ .children = std::span<Node *const>{ _data }, .size = _data.size() });
+        } else if constexpr (std::is_same_v<Data, std::span<std::pair<Node *, Node *>>>) {
+          emit(event{ .type = event_type::mapping_start, .implicit = true, .anchor = anchor });
+          _frames.push_back(frame<Node>{ .children = std::span<const std::pair<Node *, Node *>>{ _data },
+            .mapping = true,
+            .size = _data.size() * 2 });
+        } else if constexpr (std::is_same_v<Data, std::string_view>) {
+          auto multiline = _data.find('\n') != std::string_view::npos;
+          scalar(_data, detail::string_rules<Node>::plain(_data), multiline ? scalar_style::literal : scalar_style::plain);
+        } else if constexpr (std::is_same_v<Data, std::nullptr_t>)
+          scalar("null", true);
+        else if constexpr (std::is_same_v<Data, bool>)
+          scalar(_data ? "true" : "false", true);
+        else if constexpr (std::is_same_v<Data, std::int64_t>) {
+          char digits[24];
+          auto end = std::to_chars(digits, digits + sizeof(digits), _data).ptr;
+          scalar({ digits, end }, true);
+        } else if constexpr (std::is_same_v<Data, double>) {
+          char digits[40];
+          auto text = std::string_view{};
+          if (std::isnan(_data))
+            text = ".nan";
+          else if (std::isinf(_data))
+            text = _data < 0 ? "-.inf" : ".inf";
+          else {
+            auto end = std::to_chars(digits, digits + sizeof(digits) - 2, _data).ptr;
+            // keep the float resolution of integral values
+            if (std::string_view{ digits, end }.find_first_of(".e") == std::string_view::npos) {
+              *end++ = '.';
+              *end++ = '0';
+            }
+            text = { digits, end };
+          }
+          scalar(text, true);
+        }
+      },
+      _node.data);
+  }
+};
+
+// writes the tree as a yaml document
+template<typename Node> std::string dump(const Node &_root, emit_options _options = {})
+{
+  auto result = std::string{};
+  auto writer = emitter{ [&result](std::string_view _chunk) { result += _chunk; }, _options };
+  writer.dump(_root);
+  writer.flush();
+  return result;
+}
+
+template<typename Node> void dump(const Node &_root, std::ostream &_output, emit_options _options = {})
+{
+  auto writer = emitter{ _output, _options };
+  writer.dump(_root);
+  writer.flush();
+}
+
+}// namespace yaml
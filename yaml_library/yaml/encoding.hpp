@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <yaml/detail/scanner.hpp>
+#include <yaml/detail/unicode.hpp>
+#include <yaml/error.hpp>
+#include <yaml/event.hpp>
+
+namespace yaml {
+
+// character encodings of a yaml stream
+enum class encoding : std::uint8_t { utf8, utf16_le, utf16_be, utf32_le, utf32_be };
+
+// the encoding told by the byte order mark, or by the null bytes of the first character when there is none
+// x00 x00 xFE xFF | x00 x00 x00 any > UTF-32 BE
+// xFF xFE x00 x00 | any x00 x00 x00 > UTF-32 LE
+// xFE xFF | x00 any > UTF-16 BE
+// xFF xFE | any x00 > UTF-16 LE
+// anything else > UTF-8
+inline encoding detect_encoding(std::string_view _content) noexcept
+{
+  auto byte = [&](std::size_t _index) { return static_cast<unsigned char>(_content[_index]); };
+  if (_content.size() >= 4) {
+    if (!byte(0) && !byte(1) && (byte(2) == 0xFE ? byte(3) == 0xFF : !byte(2))) return encoding::utf32_be;
+    if (!byte(2) && !byte(3) && ((byte(0) == 0xFF && byte(1) == 0xFE) || (byte(0) && !byte(1))))
+      return encoding::utf32_le;
+  }
+  if (_content.size() >= 2) {
+    if ((byte(0) == 0xFE && byte(1) == 0xFF) || (!byte(0) && byte(1))) return encoding::utf16_be;
+    if ((byte(0) == 0xFF && byte(1) == 0xFE) || (byte(0) && !byte(1))) return encoding::utf16_le;
+  }
+  return encoding::utf8;
+}
+
+// whether the content is well formed utf-8, checked a vector at a time
+inline bool is_utf8(std::string_view _content) noexcept
+{
+  return detail::simd::unicode_active().validate(_content.data(), _content.size());
+}
+
+namespace detail {
+
+  // locates _index of the content, the line and column are counted on _text, the content decoded so far
+  inline mark locate(std::size_t _index, std::string_view _text) noexcept
+  {
+    auto line = static_cast<std::size_t>(std::ranges::count(_text, '\n'));
+    auto start = _text.rfind('\n');
+    return mark{ _index, line, start == std::string_view::npos ? _text.size() : _text.size() - start - 1 };
+  }
+
+  [[noreturn]] inline void invalid_utf8(std::string_view _content)
+  {
+    auto at = find_invalid_utf8(_content.data(), _content.size());
+    throw parse_error("invalid utf-8 sequence", locate(at, _content.substr(0, at)));
+  }
+
+  // room the utf-8 encoding of utf-16 or utf-32 content of Width bytes per code unit may take: a utf-16 unit takes at
+  // most 3 bytes, a surrogate pair 4. a utf-32 unit at most 4
+  template<std::size_t Width> constexpr std::size_t utf8_capacity(std::string_view _content) noexcept
+  {
+    return _content.size() / Width * (Width == 2 ? 3 : 4);
+  }
+
+  // writes the utf-8 encoding of utf-16 or utf-32 content of Width bytes per code unit to _output, which has room for
+  // utf8_capacity bytes, and returns the bytes written. ill formed content sets _problem, _at is then the offset of
+  // the code unit in the content
+  template<std::size_t Width>
+  std::size_t transcode(std::string_view _content, bool _big_endian, char *_output, std::string_view &_problem,
+    std::size_t &_at) noexcept
+  {
+    auto count = _content.size() / Width;
+    auto unit = [&](std::size_t _index) {
+      auto *bytes = reinterpret_cast<const unsigned char *>(_content.data() + _index * Width);
+      auto result = char32_t{ 0 };
+      for (auto i = std::size_t{ 0 }; i < Width; ++i)
+        result |= static_cast<char32_t>(bytes[_big_endian ? Width - 1 - i : i]) << (8 * i);
+      return result;
+    };
+    auto narrow = Width == 2 ? simd::unicode_active().narrow16 : simd::unicode_active().narrow32;
+
+    auto *out = _output;
+    auto at = std::size_t{ 0 };
+    for (; at < count; ++at) {
+      auto ascii = narrow(_content.data() + at * Width, count - at, out, _big_endian);
+      at += ascii;
+      out += ascii;
+      if (at == count) break;
+      auto code = unit(at);
+      if (Width == 2 && code >= 0xD800 && code <= 0xDFFF) {
+        if (code >= 0xDC00 || at + 1 == count || unit(at + 1) < 0xDC00 || unit(at + 1) > 0xDFFF) {
+          _problem = "unpaired utf-16 surrogate";
+          break;
+        }
+        code = 0x10000 + ((code - 0xD800) << 10) + (unit(++at) - 0xDC00);
+      } else if (Width == 4 && (code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF))) {
+        _problem = "invalid utf-32 code point";
+        break;
+      }
+      out = put_utf8(code, out);
+    }
+    if (_problem.empty() && _content.size() % Width) _problem = "truncated code unit";
+    _at = at * Width;
+    return static_cast<std::size_t>(out - _output);
+  }
+
+  // utf-8 encoding of utf-16 or utf-32 content of Width bytes per code unit, ill formed code units are reported with
+  // their offset in the content
+  template<std::size_t Width> std::string transcode(std::string_view _content, bool _big_endian)
+  {
+    auto result = std::string{};
+    auto problem = std::string_view{};
+    auto at = std::size_t{ 0 };
+    result.resize_and_overwrite(utf8_capacity<Width>(_content), [&](char *_output, std::size_t) {
+      return transcode<Width>(_content, _big_endian, _output, problem, at);
+    });
+    if (!problem.empty()) throw parse_error(problem, locate(at, result));
+    return result;
+  }
+
+  // transcodes utf-16 or utf-32 content straight into the pool, sized from the length of the content
+  inline std::string_view transcode(std::string_view _content, encoding _from, string_pool &_pool)
+  {
+    auto big_endian = _from == encoding::utf16_be || _from == encoding::utf32_be;
+    auto width = _from == encoding::utf16_le || _from == encoding::utf16_be ? 2 : 4;
+    auto problem = std::string_view{};
+    auto at = std::size_t{ 0 };
+    _pool.restart();
+    _pool.reserve(width == 2 ? utf8_capacity<2>(_content) : utf8_capacity<4>(_content));
+    _pool.extend(width == 2 ? transcode<2>(_content, big_endian, _pool.tail(), problem, at)
+                            : transcode<4>(_content, big_endian, _pool.tail(), problem, at));
+    if (!problem.empty()) {
+      auto error = parse_error(problem, locate(at, _pool.pending()));
+      _pool.restart();
+      throw error;
+    }
+    return _pool.take();
+  }
+
+}// namespace detail
+
+// the content in utf-8: utf-16 and utf-32 content is transcoded with its byte order mark, utf-8 content is copied.
+// ill formed content throws a parse_error, its index is the offset in _content while the line and column are counted
+// in the utf-8 text
+inline std::string to_utf8(std::string_view _content)
+{
+  switch (detect_encoding(_content)) {
+  case encoding::utf16_le: return detail::transcode<2>(_content, false);
+  case encoding::utf16_be: return detail::transcode<2>(_content, true);
+  case encoding::utf32_le: return detail::transcode<4>(_content, false);
+  case encoding::utf32_be: return detail::transcode<4>(_content, true);
+  case encoding::utf8: break;
+  }
+  if (!is_utf8(_content)) detail::invalid_utf8(_content);
+  return std::string{ _content };
+}
+
+namespace detail {
+
+  // the content the parser reads: utf-8 content is checked and read in place, other encodings are transcoded into the
+  // pool
+  inline std::string_view decode(std::string_view _content, string_pool &_pool)
+  {
+    if (auto from = detect_encoding(_content); from != encoding::utf8) return transcode(_content, from, _pool);
+    if (!is_utf8(_content)) invalid_utf8(_content);
+    return _content;
+  }
+
+}// namespace detail
+}// namespace yaml
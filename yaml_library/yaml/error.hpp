@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <yaml/event.hpp>
+
+namespace yaml {
+
+// default bound of the nodes a traversal of a loaded document may visit through aliases, deeper alias chains are
+// rejected with a parse_error
+inline constexpr std::size_t default_alias_expansion = 1'000'000;
+
+// thrown when the stream is ill formed, where() locates the offending character
+class parse_error : public std::runtime_error
+{
+public:
+  parse_error(std::string_view _problem, mark _where)
+    : std::runtime_error(std::string{ _problem } + " (line " + std::to_string(_where.line + 1) + ", column "
+                         + std::to_string(_where.column + 1) + ")"),
+      description(_problem), location(_where)
+  {}
+
+  // the message without the location
+  const std::string &problem() const noexcept { return description; }
+  mark where() const noexcept { return location; }
+
+private:
+  std::string description;
+  mark location;
+};
+
+}// namespace yaml
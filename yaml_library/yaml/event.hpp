@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace yaml {
+
+// position inside the input buffer, line and column are 0 based
+struct mark
+{
+  std::size_t index = 0;
+  std::size_t line = 0;
+  std::size_t column = 0;
+};
+
+enum class event_type : std::uint8_t {
+  stream_start,
+  stream_end,
+  document_start,
+  document_end,
+  alias,
+  scalar,
+  sequence_start,
+  sequence_end,
+  mapping_start,
+  mapping_end
+};
+
+enum class scalar_style : std::uint8_t { plain, single_quoted, double_quoted, literal, folded };
+
+// a parsing event, views either point into the input buffer or into storage owned by the parser's string pool
+// - document_start: implicit is set when the document has no --- marker, value holds the %YAML version if any
+// - document_end: implicit is set when the document has no ... marker
+// - scalar: value holds the content, implicit is set when the scalar is plain and untagged (subject to resolution)
+// - sequence_start / mapping_start: flow is set for flow collections, implicit is set when untagged
+// - alias: anchor holds the referenced anchor name
+struct event
+{
+  event_type type = event_type::stream_start;
+  scalar_style style = scalar_style::plain;
+  bool implicit = false;
+  bool flow = false;
+  std::string_view anchor = {};
+  std::string_view tag = {};
+  std::string_view value = {};
+  mark start = {};
+  mark end = {};
+};
+
+}// namespace yaml
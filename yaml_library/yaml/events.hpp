@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <yaml/detail/parser.hpp>
+#include <yaml/encoding.hpp>
+#include <yaml/error.hpp>
+#include <yaml/event.hpp>
+
+namespace yaml {
+
+// pulls the events of a stream without building any tree, from stream_start to stream_end. event views point into the
+// content or into the reader's arena holding the decoded scalars, they stay valid as long as both are alive
+class event_reader
+{
+public:
+  class iterator
+  {
+  public:
+    using value_type = event;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    explicit iterator(event_reader &_reader) : reader(&_reader) { ++*this; }
+
+    const event &operator*() const noexcept { return current; }
+    const event *operator->() const noexcept { return &current; }
+    iterator &operator++()
+    {
+      if (reader->done())
+        reader = nullptr;
+      else
+        current = reader->next();
+      return *this;
+    }
+    void operator++(int) { ++*this; }
+    bool operator==(std::default_sentinel_t) const noexcept { return !reader; }
+
+  private:
+    event_reader *reader = nullptr;
+    event current;
+  };
+
+  explicit event_reader(std::string_view _content) : state(std::make_unique<parsing>(_content)) {}
+
+  // true once stream_end has been pulled
+  bool done() const noexcept { return state->events.done(); }
+  const event &peek() { return state->events.peek(); }
+  event next() { return state->events.next(); }
+
+  // consumes the next node with its whole content
+  void skip()
+  {
+    auto depth = std::size_t{ 0 };
+    do {
+      auto event = next();
+      switch (event.type) {
+      case event_type::sequence_start:
+      case event_type::mapping_start: ++depth; break;
+      case event_type::sequence_end:
+      case event_type::mapping_end: --depth; break;
+      case event_type::scalar:
+      case event_type::alias: break;
+      default: throw parse_error("expected a node", event.start);
+      }
+    } while (depth);
+  }
+
+  iterator begin() { return iterator{ *this }; }
+  std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+  // boxed since the parser refers to the pool which refers to the arena
+  struct parsing
+  {
+    explicit parsing(std::string_view _content) : pool(arena), events(detail::decode(_content, pool), pool) {}
+
+    std::pmr::monotonic_buffer_resource arena;
+    detail::string_pool pool;
+    detail::parser events;
+  };
+
+  std::unique_ptr<parsing> state;
+};
+
+// calls _visitor with every event of the stream, a visitor returning a bool stops the parsing when it returns false.
+// returns false when the visitor stopped the parsing
+template<typename Visitor> bool parse(std::string_view _content, Visitor &&_visitor)
+{
+  for (auto reader = event_reader{ _content }; !reader.done();) {
+    auto event = reader.next();
+    if constexpr (std::is_same_v<std::invoke_result_t<Visitor &, const yaml::event &>, bool>) {
+      if (!_visitor(std::as_const(event))) return false;
+    } else
+      _visitor(std::as_const(event));
+  }
+  return true;
+}
+
+}// namespace yaml
@@ -0,0 +1,518 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <yaml/detail/parser.hpp>
+#include <yaml/encoding.hpp>
+#include <yaml/error.hpp>
+#include <yaml/event.hpp>
+
+namespace yaml {
+
+// navigates a document without building it, a lookup only reads the lines leading to the requested node: the entries
+// of block collections are found by their indentation and the siblings in between are skipped line by line without
+// being parsed. scalars are parsed when asked for. flow collections, node properties and keys which are not plain are
+// navigated through the events of their collection only.
+// like the spec requires, continuation lines of multi-line flow content must be indented past their parent entry.
+// the content after the first document is never read.
+// a document remembers the scalars read and the anchors met so that reading them again parses nothing, its values
+// are therefore not used by several threads at a time, even through const methods
+struct ondemand
+{
+  class document;
+
+  // cursor on a node of the document, valid as long as the document is alive
+  class value
+  {
+  public:
+    bool is_scalar() const { return node_type() == event_type::scalar; }
+    bool is_sequence() const { return node_type() == event_type::sequence_start; }
+    bool is_mapping() const { return node_type() == event_type::mapping_start; }
+
+    std::string_view scalar() const;
+
+    std::optional<value> find(std::string_view _key) const;
+    value operator[](std::string_view _key) const;
+    value operator[](std::size_t _index) const;
+
+  private:
+    friend class document;
+
+    // how parsing reaches the node: from its own start in a block or a flow context, after the key of a block mapping
+    // entry or after the indicator of a block sequence entry. the parent entry gives the node its indentation context.
+    enum class entry : std::uint8_t { node, flow_node, mapping_value, sequence_item };
+
+    struct state;
+
+    state *doc = nullptr;
+    mark start = {};
+    entry kind = entry::node;
+    std::size_t body = 0;// where the content of the node may begin
+
+    value(state *_doc, mark _start, entry _kind, std::size_t _body)
+      : doc(_doc), start(_start), kind(_kind), body(_body)
+    {}
+
+    static std::size_t skip(detail::parser &_events);
+    detail::parser open() const;
+    event_type node_type() const;
+    value resolve(const event &_alias) const;
+    std::size_t content_begin(bool &_inline) const;
+    std::size_t column(std::size_t _at) const noexcept;
+    std::size_t key_end(std::size_t _at) const noexcept;
+    bool is_entry(std::size_t _at) const noexcept;
+    std::size_t entry_indicator(std::size_t _from) const noexcept;
+    std::size_t next_sibling(std::size_t _from, std::size_t _indent, bool _sequence) const noexcept;
+    std::optional<value> find_by_events(std::string_view _key) const;
+    value item_by_events(std::size_t _index) const;
+    template<typename Function> decltype(auto) located(Function &&_function) const;
+    mark mark_at(std::size_t _index) const noexcept { return mark{ .index = _index, .column = column(_index) }; }
+  };
+
+  class document
+  {
+  public:
+    value root() const noexcept;
+    std::optional<value> find(std::string_view _key) const { return root().find(_key); }
+    value operator[](std::string_view _key) const { return root()[_key]; }
+    value operator[](std::size_t _index) const { return root()[_index]; }
+
+    // makes the document own the content it views
+    void hold(std::shared_ptr<const void> _content) noexcept;
+
+  private:
+    friend struct ondemand;
+
+    explicit document(std::string_view _content);
+
+    std::unique_ptr<value::state> shared;
+  };
+
+  // no byte past the document start is read until the document is navigated, except for utf-16 and utf-32 content
+  // which is transcoded whole. utf-8 content is not validated
+  document load(std::string_view _content) const { return document{ _content }; }
+};
+
+struct ondemand::value::state
+{
+  explicit state(std::string_view _content) : content(_content) {}
+
+  struct anchored
+  {
+    std::size_t index;
+    value node;
+  };
+
+  // a collection around the anchor scan
+  struct collection
+  {
+    bool flow;
+    bool mapping;
+    bool at_key;// the next node of the mapping is a key
+    std::size_t key = 0;// start of the key of the current entry
+    std::size_t after = 0;// end of the previous entry, or start of the collection
+  };
+
+  std::string_view content;
+  std::size_t body = 0;
+  std::pmr::monotonic_buffer_resource arena;// scalars returned and scalars met by the anchor scan
+  detail::string_pool pool{ arena };
+  std::shared_ptr<const void> held;
+
+  // scalars decoded while navigating, released once the outermost navigation returns
+  std::byte scratch_buffer[4096];
+  std::pmr::monotonic_buffer_resource scratch_arena{ scratch_buffer, sizeof(scratch_buffer) };
+  detail::string_pool scratch{ scratch_arena };
+  std::size_t depth = 0;// of the navigations in progress
+
+  // scalars read, by the start and the entry kind of their value
+  std::unordered_map<std::size_t, std::string_view> scalars;
+
+  // the anchors met so far, in document order. the scan goes on from where it stopped for aliases further on
+  std::optional<detail::parser> anchor_scan;
+  std::unordered_map<std::string_view, std::vector<anchored>> anchors;
+  std::vector<collection> around;
+
+  bool views_content(std::string_view _value) const noexcept
+  {
+    auto less = std::less<const char *>{};
+    return !less(_value.data(), content.data()) && less(_value.data(), content.data() + content.size());
+  }
+};
+
+inline ondemand::document::document(std::string_view _content) : shared(std::make_unique<value::state>(_content))
+{
+  // utf-16 and utf-32 content is transcoded as a whole, utf-8 content is left unchecked as it is read lazily
+  if (auto from = detect_encoding(_content); from != encoding::utf8)
+    _content = shared->content = detail::transcode(_content, from, shared->pool);
+  // the root content follows the directives and the document start marker
+  auto line = _content.starts_with("\xEF\xBB\xBF") ? std::size_t{ 3 } : std::size_t{ 0 };
+  while (line < _content.size()) {
+    auto rest = _content.substr(line);
+    auto first = rest.find_first_not_of(" \t");
+    auto empty = first == std::string_view::npos || detail::is_break(rest[first]) || rest[first] == '#';
+    if (rest.starts_with("---") && (rest.size() == 3 || detail::is_blank_or_end(rest[3]))) {
+      shared->body = line + 3;
+      return;
+    }
+    if (!empty && rest.front() != '%') break;
+    auto end = rest.find('\n');
+    if (end == std::string_view::npos) break;
+    line += end + 1;
+  }
+  shared->body = line;
+}
+
+inline ondemand::value ondemand::document::root() const noexcept
+{
+  return value{ shared.get(), {}, value::entry::node, shared->body };
+}
+
+inline void ondemand::document::hold(std::shared_ptr<const void> _content) noexcept { shared->held = std::move(_content); }
+
+// parse errors are located from the start of the parsing, lines are counted again from the start of the content.
+// the scalars decoded on the way are dropped when the outermost navigation returns
+template<typename Function> decltype(auto) ondemand::value::located(Function &&_function) const
+{
+  struct navigation
+  {
+    state *doc;
+    explicit navigation(state *_doc) : doc(_doc) { ++doc->depth; }
+    ~navigation()
+    {
+      if (--doc->depth) return;
+      doc->scratch.clear();
+      doc->scratch_arena.release();
+    }
+  } scope{ doc };
+  try {
+    return std::forward<Function>(_function)();
+  } catch (const parse_error &_error) {
+    auto where = _error.where();
+    auto before = doc->content.substr(0, std::min(where.index, doc->content.size()));
+    where.line = static_cast<std::size_t>(std::ranges::count(before, '\n'));
+    throw parse_error(_error.problem(), where);
+  }
+}
+
+// consumes a whole node, returns where it ends
+inline std::size_t ondemand::value::skip(detail::parser &_events)
+{
+  for (auto depth = std::size_t{ 0 };;) {
+    auto event = _events.next();
+    if (event.type == event_type::sequence_start || event.type == event_type::mapping_start) ++depth;
+    if (event.type == event_type::sequence_end || event.type == event_type::mapping_end) --depth;
+    if (!depth) return event.end.index;
+  }
+}
+
+// a parser positioned on the first event of the node
+inline detail::parser ondemand::value::open() const
+{
+  auto events = detail::parser{ doc->content, doc->scratch, start, kind == entry::flow_node };
+  events.next();
+  events.next();
+  if (kind == entry::sequence_item) events.next();
+  if (kind == entry::mapping_value) {
+    events.next();
+    skip(events);
+  }
+  return events;
+}
+
+inline event_type ondemand::value::node_type() const
+{
+  return located([&] {
+    auto events = open();
+    auto node = events.next();
+    return node.type == event_type::alias ? resolve(node).node_type() : node.type;
+  });
+}
+
+// the node of the last anchor with the alias name defined before the alias. the document is scanned once from its
+// start, up to the furthest alias resolved so far
+inline ondemand::value ondemand::value::resolve(const event &_alias) const
+{
+  if (!doc->anchor_scan) doc->anchor_scan.emplace(doc->content, doc->pool);
+  auto &events = *doc->anchor_scan;
+  auto &around = doc->around;
+  try {
+    while (!events.done() && events.peek().start.index < _alias.start.index) {
+      auto event = events.next();
+      auto starts = event.type == event_type::sequence_start || event.type == event_type::mapping_start;
+      if (event.type == event_type::sequence_end || event.type == event_type::mapping_end) around.pop_back();
+      auto *parent = around.empty() ? nullptr : &around.back();
+      if (starts || event.type == event_type::scalar || event.type == event_type::alias) {
+        auto where = event.start.index;
+        auto node = value{ doc, mark_at(where), entry::node, where };
+        // keys are single lines, block entries are parsed from their key or indicator to keep their indentation
+        if (parent && (parent->flow || parent->at_key)) node.kind = entry::flow_node;
+        else if (parent && parent->mapping) {
+          node.start = mark_at(parent->key);
+          node.kind = entry::mapping_value;
+        } else if (parent) {
+          node.start = mark_at(entry_indicator(parent->after));
+          node.kind = entry::sequence_item;
+        }
+        if (!event.anchor.empty() && event.type != event_type::alias)
+          doc->anchors[event.anchor].push_back(state::anchored{ where, node });
+        if (parent && parent->mapping) {
+          if (parent->at_key) parent->key = where;
+          parent->at_key = !parent->at_key;
+        }
+      }
+      if (starts) {
+        auto mapping = event.type == event_type::mapping_start;
+        around.push_back(state::collection{ .flow = event.flow, .mapping = mapping, .at_key = mapping,
+                                            .after = event.start.index });
+      } else if (parent)
+        parent->after = event.end.index;
+    }
+  } catch (...) {
+    // the next alias scans again from the start
+    doc->anchor_scan.reset();
+    doc->anchors.clear();
+    around.clear();
+    throw;
+  }
+
+  if (auto found = doc->anchors.find(_alias.anchor); found != doc->anchors.end()) {
+    auto &defined = found->second;
+    auto after = std::ranges::lower_bound(defined, _alias.start.index, {}, &state::anchored::index);
+    if (after != defined.begin()) return std::prev(after)->node;
+  }
+  throw parse_error("found undefined alias", _alias.start);
+}
+
+inline std::string_view ondemand::value::scalar() const
+{
+  auto key = start.index * 4 + static_cast<std::size_t>(kind);
+  if (auto found = doc->scalars.find(key); found != doc->scalars.end()) return found->second;
+  return located([&] {
+    auto events = open();
+    auto node = events.next();
+    auto result = std::string_view{};
+    if (node.type == event_type::alias)
+      result = resolve(node).scalar();
+    else if (node.type != event_type::scalar)
+      throw std::invalid_argument("node is not a scalar");
+    else
+      // decoded scalars outlive the navigation in the pool
+      result = doc->views_content(node.value) ? node.value : doc->pool.store(node.value);
+    doc->scalars.emplace(key, result);
+    return result;
+  });
+}
+
+inline std::size_t ondemand::value::column(std::size_t _at) const noexcept
+{
+  auto line = _at ? doc->content.rfind('\n', _at - 1) : std::string_view::npos;
+  if (line != std::string_view::npos) return _at - line - 1;
+  // the byte order mark takes no column
+  return _at >= 3 && doc->content.starts_with("\xEF\xBB\xBF") ? _at - 3 : _at;
+}
+
+// first byte of the content, blanks, line breaks and comments are skipped. _inline is cleared when the content starts
+// on a following line
+inline std::size_t ondemand::value::content_begin(bool &_inline) const
+{
+  auto &content = doc->content;
+  _inline = true;
+  auto at = body;
+  while (at < content.size()) {
+    auto c = content[at];
+    if (detail::is_blank(c))
+      ++at;
+    else if (c == '#')
+      at = std::min(content.find('\n', at), content.size());
+    else if (detail::is_break(c)) {
+      _inline = false;
+      ++at;
+    } else
+      break;
+  }
+  return at;
+}
+
+// the ':' ending a plain implicit key starting at _at, npos when the line does not start with such a key
+inline std::size_t ondemand::value::key_end(std::size_t _at) const noexcept
+{
+  auto &content = doc->content;
+  if (_at >= content.size()) return std::string_view::npos;
+  switch (content[_at]) {
+  case '[':
+  case ']':
+  case '{':
+  case '}':
+  case ',':
+  case '"':
+  case '\'':
+  case '&':
+  case '!':
+  case '*':
+  case '?':
+  case ':':
+  case '|':
+  case '>':
+  case '%':
+  case '@':
+  case '`':
+  case '#': return std::string_view::npos;
+  case '-':
+    if (is_entry(_at)) return std::string_view::npos;
+    break;
+  default: break;
+  }
+  for (auto at = _at;; ++at) {
+    at = content.find_first_of(":#\r\n", at);
+    if (at == std::string_view::npos || detail::is_break(content[at])) return std::string_view::npos;
+    auto next = at + 1 < content.size() ? content[at + 1] : '\0';
+    if (content[at] == ':' && detail::is_blank_or_end(next)) return at;
+    if (content[at] == '#' && detail::is_blank(content[at - 1])) return std::string_view::npos;
+  }
+}
+
+inline bool ondemand::value::is_entry(std::size_t _at) const noexcept
+{
+  auto &content = doc->content;
+  return _at < content.size() && content[_at] == '-'
+         && (_at + 1 == content.size() || detail::is_blank_or_end(content[_at + 1]));
+}
+
+// the indicator of the block sequence entry following _from, past blanks, line breaks and comments
+inline std::size_t ondemand::value::entry_indicator(std::size_t _from) const noexcept
+{
+  auto &content = doc->content;
+  auto at = _from;
+  while (at < content.size() && content[at] != '-')
+    at = content[at] == '#' ? std::min(content.find('\n', at), content.size()) : at + 1;
+  return at;
+}
+
+// first byte of the next line indented at most _indent, npos at the end of the document. blank lines, comments and
+// more indented lines are skipped, so are the entries of a sequence indented like the keys of its mapping
+inline std::size_t ondemand::value::next_sibling(std::size_t _from, std::size_t _indent, bool _sequence) const noexcept
+{
+  auto &content = doc->content;
+  for (auto line = content.find('\n', _from); line != std::string_view::npos; line = content.find('\n', line)) {
+    ++line;
+    auto first = content.find_first_not_of(' ', line);
+    if (first == std::string_view::npos) break;
+    auto blank = content.find_first_not_of(" \t", first);
+    if (blank == std::string_view::npos) break;
+    if (detail::is_break(content[blank]) || content[blank] == '#') continue;
+
+    auto indent = first - line;
+    if (indent > _indent) continue;
+    auto rest = content.substr(first);
+    if (indent == 0 && (rest.starts_with("---") || rest.starts_with("..."))
+        && (rest.size() == 3 || detail::is_blank_or_end(rest[3])))
+      break;
+    if (indent == _indent && !_sequence && is_entry(first)) continue;
+    return first;
+  }
+  return std::string_view::npos;
+}
+
+inline std::optional<ondemand::value> ondemand::value::find(std::string_view _key) const
+{
+  auto single_line = true;
+  auto at = content_begin(single_line);
+  auto indent = column(at);
+  // content on a following line must be indented past its parent entry, or be the entries of a sequence value
+  auto nested = single_line || kind == entry::node || indent > start.column
+                || (kind == entry::mapping_value && indent == start.column && is_entry(at));
+  if (!nested || key_end(at) == std::string_view::npos) return find_by_events(_key);
+
+  while (at != std::string_view::npos && column(at) == indent) {
+    auto colon = key_end(at);
+    if (colon == std::string_view::npos) return find_by_events(_key);
+    auto key = doc->content.substr(at, colon - at);
+    key = key.substr(0, key.find_last_not_of(" \t") + 1);
+    if (key == _key) return value{ doc, mark{ .index = at, .column = indent }, entry::mapping_value, colon + 1 };
+    at = next_sibling(colon + 1, indent, false);
+  }
+  return std::nullopt;
+}
+
+inline std::optional<ondemand::value> ondemand::value::find_by_events(std::string_view _key) const
+{
+  return located([&]() -> std::optional<value> {
+    auto events = open();
+    auto node = events.next();
+    if (node.type == event_type::alias) return resolve(node).find(_key);
+    if (node.type != event_type::mapping_start) throw std::invalid_argument("node is not a mapping");
+
+    while (events.peek().type != event_type::mapping_end) {
+      auto key = events.peek();
+      if (key.type == event_type::scalar && key.value == _key) {
+        events.next();
+        // a block entry is parsed from its key to keep its indentation context
+        if (!node.flow) return value{ doc, mark_at(key.start.index), entry::mapping_value, events.peek().start.index };
+        auto child = events.peek().start.index;
+        return value{ doc, mark_at(child), entry::flow_node, child };
+      }
+      skip(events);
+      skip(events);
+    }
+    return std::nullopt;
+  });
+}
+
+inline ondemand::value ondemand::value::operator[](std::string_view _key) const
+{
+  if (auto found = find(_key)) return *found;
+  throw std::out_of_range("key not found in mapping: " + std::string{ _key });
+}
+
+inline ondemand::value ondemand::value::operator[](std::size_t _index) const
+{
+  auto single_line = true;
+  auto at = content_begin(single_line);
+  auto indent = column(at);
+  auto nested = single_line || kind == entry::node || indent > start.column
+                || (kind == entry::mapping_value && indent == start.column);
+  if (!nested || !is_entry(at)) return item_by_events(_index);
+
+  for (auto remaining = _index; at != std::string_view::npos && column(at) == indent && is_entry(at); --remaining) {
+    if (!remaining) return value{ doc, mark{ .index = at, .column = indent }, entry::sequence_item, at + 1 };
+    at = next_sibling(at + 1, indent, true);
+  }
+  throw std::out_of_range("index out of sequence range");
+}
+
+inline ondemand::value ondemand::value::item_by_events(std::size_t _index) const
+{
+  return located([&] {
+    auto events = open();
+    auto node = events.next();
+    if (node.type == event_type::alias) return resolve(node)[_index];
+    if (node.type != event_type::sequence_start) throw std::invalid_argument("node is not a sequence");
+    for (auto after = node.start.index, remaining = _index; events.peek().type != event_type::sequence_end;
+         --remaining) {
+      auto child = events.peek().start.index;
+      if (!remaining) {
+        if (node.flow) return value{ doc, mark_at(child), entry::flow_node, child };
+        // a block entry is parsed from its indicator to keep its indentation context
+        return value{ doc, mark_at(entry_indicator(after)), entry::sequence_item, child };
+      }
+      after = skip(events);
+    }
+    throw std::out_of_range("index out of sequence range");
+  });
+}
+
+}// namespace yaml
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <yaml/detail/splitter.hpp>
+#include <yaml/encoding.hpp>
+#include <yaml/yaml.hpp>
+
+namespace yaml {
+namespace detail {
+
+  struct document_range
+  {
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    std::size_t line = 0;// line of begin in the content
+  };
+
+  // runs _task for every index below _count on up to _threads threads, the calling thread included. workers claim
+  // batches of consecutive indexes, a task returning false stops the claims past its index while the tasks before it
+  // still run
+  template<typename Task> void run_parallel(std::size_t _count, std::size_t _threads, Task &&_task)
+  {
+    auto batch = std::max<std::size_t>(1, _count / (std::max<std::size_t>(_threads, 1) * 16));
+    auto claimed = std::atomic<std::size_t>{ 0 };
+    auto failed = std::atomic<std::size_t>{ _count };
+    auto work = [&] {
+      for (;;) {
+        auto first = claimed.fetch_add(batch, std::memory_order_relaxed);
+        if (first >= std::min(_count, failed.load(std::memory_order_relaxed))) return;
+        for (auto index = first; index < std::min(first + batch, _count); ++index) {
+          if (_task(index)) continue;
+          for (auto previous = failed.load(); index < previous && !failed.compare_exchange_weak(previous, index);) {}
+          return;
+        }
+      }
+    };
+
+    auto workers = std::vector<std::jthread>{};
+    auto count = std::min(_threads, (_count + batch - 1) / batch);
+    for (auto i = std::size_t{ 1 }; i < count; ++i) workers.emplace_back(work);
+    work();
+  }
+
+  // the documents of the content, found without parsing them
+  inline std::vector<document_range> split_documents(std::string_view _content)
+  {
+    auto result = std::vector<document_range>{};
+    auto splitter = document_splitter{};
+    auto current = document_range{};
+    auto line = std::size_t{ 0 };
+    for (auto at = std::size_t{ 0 }; at < _content.size(); ++line) {
+      auto end = _content.find('\n', at);
+      end = end == std::string_view::npos ? _content.size() : end + 1;
+      auto text = _content.substr(at, end - at);
+      if (at == 0 && text.starts_with("\xEF\xBB\xBF")) text.remove_prefix(3);
+      switch (splitter.next_line(text)) {
+      case document_splitter::split::before:
+        current.end = at;
+        result.push_back(current);
+        current = document_range{ at, at, line };
+        break;
+      case document_splitter::split::after:
+        current.end = end;
+        result.push_back(current);
+        [[fallthrough]];
+      case document_splitter::split::drop: current = document_range{ end, end, line + 1 }; break;
+      case document_splitter::split::none: break;
+      }
+      at = end;
+    }
+    if (splitter.finish()) {
+      current.end = _content.size();
+      result.push_back(current);
+    }
+    return result;
+  }
+
+  // starts of at most _count chunks of the collection, each starting an entry of the top level collection. the first
+  // chunk starts with the content
+  inline std::vector<std::size_t> split_entries(std::string_view _content, block_root _root, std::size_t _count)
+  {
+    auto result = std::vector<std::size_t>{ 0 };
+    auto span = _content.size() - _root.body;
+    for (auto i = std::size_t{ 1 }; i < _count; ++i) {
+      auto from = std::max(_root.body + span * i / _count, result.back() + 1);
+      if (from >= _content.size()) break;
+      auto index = structural_index{ _content, from };
+      auto position = next_line(_content, index, from);
+      while (position < _content.size() && !is_entry_line(_content, position, _root.sequence))
+        position = next_line(_content, index, position);
+      if (position >= _content.size()) break;
+      result.push_back(position);
+    }
+    return result;
+  }
+
+}// namespace detail
+
+// loads every document of the stream on up to _threads threads and returns them in the stream order. the stream is
+// split on the document markers starting a line before any parsing, each document is then loaded on its own with its
+// directives. like load, the documents are views of the content which the caller keeps alive. when documents are ill
+// formed the error of the first one in the stream is thrown, with its position in the whole stream.
+template<schematic Schema = failsafe>
+auto load_all_parallel(
+  std::string_view _content, std::size_t _threads = std::thread::hardware_concurrency(), Schema _schema = {})
+  -> std::vector<decltype(_schema.load(_content))>
+{
+  using document_type = decltype(_schema.load(_content));
+  // the documents are split on utf-8 lines, other encodings are transcoded first and kept alive by the documents
+  if (detect_encoding(_content) != encoding::utf8) {
+    auto text = std::make_shared<const std::string>(to_utf8(_content));
+    auto result = load_all_parallel(*text, _threads, std::move(_schema));
+    if constexpr (requires(document_type &_document) { _document.hold(text); })
+      for (auto &document : result) document.hold(text);
+    return result;
+  }
+  auto ranges = detail::split_documents(_content);
+  auto loaded = std::vector<std::optional<document_type>>(ranges.size());
+  auto errors = std::vector<std::exception_ptr>(ranges.size());
+
+  detail::run_parallel(ranges.size(), _threads, [&](std::size_t _index) {
+    auto range = ranges[_index];
+    try {
+      loaded[_index] = _schema.load(_content.substr(range.begin, range.end - range.begin));
+      return true;
+    } catch (const parse_error &_error) {
+      auto at = _error.where();
+      errors[_index] = std::make_exception_ptr(
+        parse_error(_error.problem(), mark{ at.index + range.begin, at.line + range.line, at.column }));
+    } catch (...) {
+      errors[_index] = std::current_exception();
+    }
+    return false;
+  });
+
+  auto result = std::vector<document_type>{};
+  result.reserve(ranges.size());
+  for (auto index = std::size_t{ 0 }; index < ranges.size(); ++index) {
+    if (errors[index]) std::rethrow_exception(errors[index]);
+    result.push_back(std::move(*loaded[index]));
+  }
+  return result;
+}
+
+// loads the single document of the stream like Schema::load, splitting its top level block collection into chunks
+// parsed on up to _threads threads. chunks start at entries of the collection found on the first column of a line,
+// the chunk trees are then stitched into a single collection. a split point cannot be told apart from a line of a
+// quoted scalar, a flow collection or a block scalar without parsing, so such splits are left to the chunk parsers:
+// whenever a chunk fails to load, is not a collection of the root kind, or holds a document marker, or when the root
+// has directives or properties, the whole content is loaded serially which also reports the errors. aliases can only
+// refer to anchors of their own chunk, other aliases fall back too. small contents and the ones encoded in utf-16 or
+// utf-32 are always loaded serially.
+// the schema builds trees through its composer like failsafe, core and json.
+template<schematic Schema = failsafe>
+auto load_parallel(
+  std::string_view _content, std::size_t _threads = std::thread::hardware_concurrency(), Schema _schema = {})
+{
+  using document_type = decltype(_schema.load(_content));
+  using node = typename document_type::node_type;
+  using node_ref = node *;
+  // below this size per chunk the threads cost more than they save
+  constexpr auto min_chunk_size = std::size_t{ 64 * 1024 };
+
+  if (detect_encoding(_content) != encoding::utf8) return _schema.load(_content);
+  auto root = detail::find_block_root(_content);
+  auto count = std::min(std::max<std::size_t>(_threads, 1) * 4, _content.size() / min_chunk_size);
+  if (!root || _threads <= 1 || count <= 1) return _schema.load(_content);
+  auto starts = detail::split_entries(_content, *root, count);
+  if (starts.size() <= 1) return _schema.load(_content);
+  starts.push_back(_content.size());
+
+  // the expansions of the chunks add up, each one gets its share of the limit
+  auto alias_limit = _schema.max_alias_expansion / (starts.size() - 1);
+  auto chunks = std::vector<std::optional<document_type>>(starts.size() - 1);
+  auto failed = std::atomic<bool>{ false };
+  auto errors = std::vector<std::exception_ptr>(chunks.size());
+  detail::run_parallel(chunks.size(), _threads, [&](std::size_t _index) {
+    auto text = _content.substr(starts[_index], starts[_index + 1] - starts[_index]);
+    // a parse error tells an ambiguous split, other errors are not left to the serial load
+    if (!detail::has_marker(_index == 0 ? text.substr(root->body) : text)) try {
+        auto &chunk = chunks[_index].emplace(detail::compose_single(_schema, text, alias_limit));
+        if (root->sequence ? std::holds_alternative<typename Schema::sequence>(chunk->data)
+                           : std::holds_alternative<typename Schema::mapping>(chunk->data))
+          return true;
+      } catch (const parse_error &) {
+      } catch (...) {
+        errors[_index] = std::current_exception();
+      }
+    failed = true;
+    return false;
+  });
+  for (auto &error : errors)
+    if (error) std::rethrow_exception(error);
+  if (failed) return _schema.load(_content);
+
+  auto result = document_type{};
+  auto size = std::size_t{ 0 };
+  for (auto &chunk : chunks)
+    size += root->sequence ? std::get<typename Schema::sequence>((*chunk)->data).size()
+                           : std::get<typename Schema::mapping>((*chunk)->data).size();
+  if (root->sequence) {
+    using sequence = typename Schema::sequence;
+    auto *data = static_cast<node_ref *>(result.resource().allocate(size * sizeof(node_ref), alignof(node_ref)));
+    auto *end = data;
+    for (auto &chunk : chunks) end = std::ranges::copy(std::get<sequence>((*chunk)->data), end).out;
+    result.set_root(result.create(sequence{ data, size }));
+  } else {
+    using mapping = typename Schema::mapping;
+    using pair = std::pair<node_ref, node_ref>;
+    auto *data = static_cast<pair *>(result.resource().allocate(size * sizeof(pair), alignof(pair)));
+    auto *end = data;
+    for (auto &chunk : chunks)
+      for (auto &entry : std::get<mapping>((*chunk)->data)) std::construct_at(end++, entry);
+    result.set_root(result.create(mapping{ data, size }));
+  }
+  // the entries stay in the arenas of the chunks
+  auto held = std::make_shared<std::vector<document_type>>();
+  held->reserve(chunks.size());
+  for (auto &chunk : chunks) held->push_back(std::move(*chunk));
+  result.hold(std::move(held));
+  return result;
+}
+
+}// namespace yaml
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <yaml/detail/composer.hpp>
+#include <yaml/detail/parser.hpp>
+#include <yaml/detail/scanner.hpp>
+#include <yaml/document.hpp>
+#include <yaml/encoding.hpp>
+#include <yaml/yaml.hpp>
+
+namespace yaml {
+namespace detail {
+
+  // hands out the memory of the blocks it keeps one after the other and only takes a new block from the heap when
+  // they are used up. deallocation does nothing, rewind() makes every block available again without freeing it
+  class recycling_resource : public std::pmr::memory_resource
+  {
+  public:
+    recycling_resource() = default;
+    recycling_resource(const recycling_resource &) = delete;
+    recycling_resource &operator=(const recycling_resource &) = delete;
+
+    ~recycling_resource() override
+    {
+      for (auto &kept : blocks) upstream->deallocate(kept.data, kept.size, alignof(std::max_align_t));
+    }
+
+    void rewind() noexcept
+    {
+      current = 0;
+      used = 0;
+    }
+
+    // bytes of the blocks kept
+    std::size_t capacity() const noexcept
+    {
+      auto result = std::size_t{ 0 };
+      for (auto &kept : blocks) result += kept.size;
+      return result;
+    }
+
+  private:
+    static constexpr std::size_t first_block = 4096;
+
+    struct block
+    {
+      std::byte *data;
+      std::size_t size;
+    };
+
+    std::pmr::memory_resource *upstream = std::pmr::get_default_resource();
+    std::vector<block> blocks;
+    std::size_t current = 0;
+    std::size_t used = 0;// of the current block
+
+    void *do_allocate(std::size_t _bytes, std::size_t _alignment) override
+    {
+      for (;; ++current, used = 0) {
+        if (current == blocks.size()) {
+          // blocks double so that a larger load settles after a few resets
+          auto size = std::max(_bytes + _alignment, blocks.empty() ? first_block : blocks.back().size * 2);
+          blocks.reserve(blocks.size() + 1);
+          auto *data = static_cast<std::byte *>(upstream->allocate(size, alignof(std::max_align_t)));
+          blocks.push_back(block{ data, size });
+        }
+        void *at = blocks[current].data + used;
+        auto space = blocks[current].size - used;
+        if (std::align(_alignment, _bytes, at, space)) {
+          used = blocks[current].size - space + _bytes;
+          return at;
+        }
+      }
+    }
+
+    void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &_other) const noexcept override { return this == &_other; }
+  };
+
+}// namespace detail
+
+// loads many small documents in a row with the same storage: the arena of the nodes, the buffers of the scanner, the
+// stacks of the parser and the composer and the anchor table are kept from one load to the next. the documents
+// loaded stay valid until reset(), which recycles their memory for the next loads instead of freeing it. once the
+// parser has seen payloads of a given size, loading more of them allocates nothing.
+// a parser is neither copied nor moved, and is used by one thread at a time
+template<schematic Schema = failsafe> class parser
+{
+public:
+  using node = typename Schema::node;
+  using node_ref = node *;
+
+  explicit parser(Schema _schema = {}) : schema(std::move(_schema)) {}
+
+  parser(const parser &) = delete;
+  parser &operator=(const parser &) = delete;
+
+  // loads the single document of the stream, an empty stream is loaded as an empty scalar. the scalars may view the
+  // content, the caller keeps it alive until the next reset. a load failing with a parse_error leaves the parser
+  // ready for the next one
+  const node &load(std::string_view _content)
+  {
+    events.reset(detail::decode(_content, pool));
+    builder.restart(schema.max_alias_expansion);
+    return *detail::compose_events(schema, tree, events, builder);
+  }
+
+  // drops every document loaded since the last reset, their memory is kept for the next loads
+  void reset() noexcept
+  {
+    pool.clear();
+    tree.clear();
+    arena.rewind();
+  }
+
+  // bytes kept for the nodes and the decoded scalars
+  std::size_t capacity() const noexcept { return arena.capacity(); }
+
+private:
+  Schema schema;
+  detail::recycling_resource arena;
+  document<node> tree{ arena };
+  detail::string_pool pool{ tree.resource() };
+  std::pmr::unsynchronized_pool_resource anchors;
+  detail::parser events{ {}, pool };
+  detail::composer<Schema> builder{ schema, tree, schema.max_alias_expansion, nullptr, &anchors };
+};
+
+}// namespace yaml
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <utility>
+
+namespace yaml {
+
+// figures of a single load, gathered only by the schemas asking for them, see instrumented
+struct load_stats
+{
+  std::size_t bytes = 0;// content scanned
+  std::size_t events = 0;// of the nodes, the stream and document events are left out
+  std::size_t scalars = 0;
+  std::size_t sequences = 0;
+  std::size_t mappings = 0;
+  std::size_t aliases = 0;
+  std::size_t max_depth = 0;// of the collections
+  std::size_t alias_expansion = 0;// nodes visited through aliases
+  // requests the load made to the heap and their size: the arena of the document with its decoded scalars, the
+  // structural index and the token queue of the scanner, the stacks of the parser and the composer, the anchor table
+  std::size_t allocations = 0;
+  std::size_t allocated_bytes = 0;
+  // time of each phase: scanning the tokens, parsing them into events, composing the tree from the events and
+  // constructing the nodes of the scalars, their native values included. the clock is read when the load goes from
+  // a phase to another, total also counts the reading of the clock
+  std::chrono::nanoseconds scan{};
+  std::chrono::nanoseconds parse{};
+  std::chrono::nanoseconds compose{};
+  std::chrono::nanoseconds construct{};
+  std::chrono::nanoseconds total{};
+};
+
+namespace detail {
+
+  // schemas gathering load_stats while composing
+  template<typename Schema>
+  concept gathers_stats = requires { requires Schema::gathers_stats; };
+
+  // forwards to the default resource and counts the blocks requested from the calling thread
+  class counting_resource : public std::pmr::memory_resource
+  {
+  public:
+    static inline thread_local std::size_t allocations = 0;
+    static inline thread_local std::size_t allocated_bytes = 0;
+
+    static counting_resource &instance() noexcept
+    {
+      static auto result = counting_resource{};
+      return result;
+    }
+
+  private:
+    void *do_allocate(std::size_t _bytes, std::size_t _alignment) override
+    {
+      ++allocations;
+      allocated_bytes += _bytes;
+      return std::pmr::get_default_resource()->allocate(_bytes, _alignment);
+    }
+
+    void do_deallocate(void *_pointer, std::size_t _bytes, std::size_t _alignment) override
+    {
+      std::pmr::get_default_resource()->deallocate(_pointer, _bytes, _alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &_other) const noexcept override { return this == &_other; }
+  };
+
+  enum class phase : std::uint8_t { scan, parse, compose, construct };
+
+  // splits the time of a load between its phases, the clock is read once at each change of phase and the time since
+  // the previous change goes to the phase left
+  class phase_timer
+  {
+  public:
+    phase_timer(load_stats &_stats, phase _first) noexcept
+      : stats(&_stats), current(_first), last(std::chrono::steady_clock::now())
+    {}
+
+    // returns the phase left
+    phase enter(phase _next) noexcept
+    {
+      auto now = std::chrono::steady_clock::now();
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last);
+      switch (current) {
+      case phase::scan: stats->scan += elapsed; break;
+      case phase::parse: stats->parse += elapsed; break;
+      case phase::compose: stats->compose += elapsed; break;
+      case phase::construct: stats->construct += elapsed; break;
+      }
+      last = now;
+      return std::exchange(current, _next);
+    }
+
+  private:
+    load_stats *stats;
+    phase current;
+    std::chrono::steady_clock::time_point last;
+  };
+
+}// namespace detail
+}// namespace yaml
@@ -0,0 +1,618 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <yaml/detail/composer.hpp>
+#include <yaml/detail/parser.hpp>
+#include <yaml/detail/splitter.hpp>
+#include <yaml/document.hpp>
+#include <yaml/encoding.hpp>
+#include <yaml/event.hpp>
+#include <yaml/stats.hpp>
+#include <yaml/yaml.hpp>
+
+namespace yaml {
+namespace detail {
+
+  // a document split from a stream and its position in the stream
+  struct document_text
+  {
+    std::shared_ptr<std::string> text;
+    mark where;
+  };
+
+  // the text of a document in the buffer of document_lines, valid until the buffer is next changed
+  struct document_view
+  {
+    std::string_view text;
+    mark where;
+  };
+
+  // splits a stream received piece by piece into documents: complete lines go through the document_splitter, a line
+  // cut by the end of the bytes received so far waits for the next ones. the buffer holds the utf-8 lines of the
+  // current document from begin to scanned, then the text received ahead. the lines handed over are only dropped once
+  // they make half of the buffer, so each byte is moved a bounded number of times.
+  // the encoding is detected from the first 4 bytes. utf-8 bytes are received straight into the buffer, utf-16 and
+  // utf-32 bytes wait in raw until they complete code units, which are transcoded at the end of the buffer
+  class document_lines
+  {
+  public:
+    // room for _count more bytes at the end of the input, commit() then tells how many were written
+    std::span<char> prepare(std::size_t _count)
+    {
+      auto &input = source == encoding::utf8 ? buffer : raw;
+      if (source == encoding::utf8) compact();
+      prepared = input.size();
+      input.resize(prepared + _count);
+      return std::span<char>{ input }.subspan(prepared);
+    }
+
+    void commit(std::size_t _count) { (source == encoding::utf8 ? buffer : raw).resize(prepared + _count); }
+
+    void append(std::span<const char> _bytes)
+    {
+      if (source == encoding::utf8) compact();
+      (source == encoding::utf8 ? buffer : raw).append(_bytes.data(), _bytes.size());
+    }
+
+    // the next document completed by the bytes received, nullopt when it needs more of them. once the stream has
+    // _ended, its last lines are a document of their own
+    std::optional<document_text> next(bool _ended)
+    {
+      auto result = split(_ended);
+      if (!result) return std::nullopt;
+      return document_text{ std::make_shared<std::string>(result->text), result->where };
+    }
+
+    // as next() without copying the document, the view is valid until the next call
+    std::optional<document_view> split(bool _ended)
+    {
+      if (source != encoding::utf8) transcode(_ended);
+      for (;;) {
+        auto end = buffer.find('\n', std::max(scanned, searched));
+        if (end == std::string::npos) {
+          searched = buffer.size();
+          if (!_ended) return std::nullopt;
+          if (scanned == buffer.size()) {
+            if (splitter.finish()) return take();
+            discard();
+            return std::nullopt;
+          }
+          end = buffer.size();
+        } else
+          ++end;
+
+        auto line = std::string_view{ buffer }.substr(scanned, end - scanned);
+        if (offset + scanned == 0 && line.starts_with("\xEF\xBB\xBF")) line.remove_prefix(3);
+
+        switch (splitter.next_line(line)) {
+        case document_splitter::split::before: {
+          // the marker opens the next document
+          auto result = take();
+          consume(end);
+          return result;
+        }
+        case document_splitter::split::after: consume(end); return take();
+        case document_splitter::split::drop:
+          consume(end);
+          discard();
+          break;
+        case document_splitter::split::none: consume(end); break;
+        }
+      }
+    }
+
+    // position after the bytes received
+    mark end() const noexcept
+    {
+      auto last = buffer.rfind('\n');
+      auto column = buffer.size() - (last == std::string::npos ? 0 : last + 1);
+      return mark{ .index = offset + buffer.size(), .line = line + scanned_lines, .column = column };
+    }
+
+    // the complete lines received since the last document, which may start the next one
+    document_view open() const noexcept
+    {
+      auto text = std::string_view{ buffer }.substr(begin, scanned - begin);
+      return { text, mark{ .index = offset + begin, .line = line } };
+    }
+
+  private:
+    std::string buffer;
+    std::optional<encoding> source;// until the first bytes are received
+    std::string raw;// bytes of the stream not transcoded yet
+    std::size_t transcoded = 0;// bytes of the stream before raw
+    std::size_t prepared = 0;
+    std::size_t begin = 0;
+    std::size_t scanned = 0;
+    std::size_t searched = 0;
+    std::size_t scanned_lines = 0;
+    // position of the buffer in the stream and line of begin
+    std::size_t offset = 0;
+    std::size_t line = 0;
+    document_splitter splitter;
+
+    void consume(std::size_t _end) noexcept
+    {
+      if (buffer[_end - 1] == '\n') ++scanned_lines;
+      scanned = _end;
+    }
+
+    // drops the scanned lines
+    void discard() noexcept
+    {
+      begin = scanned;
+      line += scanned_lines;
+      scanned_lines = 0;
+    }
+
+    // the scanned lines make a document
+    document_view take() noexcept
+    {
+      auto result = open();
+      discard();
+      return result;
+    }
+
+    // appends the complete code units of raw to the buffer. a utf-16 high surrogate waits for the unit pairing it,
+    // unless the stream has _ended, when the incomplete units left are reported
+    void transcode(bool _ended)
+    {
+      if (!source) {
+        if (raw.size() < 4 && !_ended) return;
+        source = detect_encoding(raw);
+        if (source == encoding::utf8) {
+          buffer = std::move(raw);
+          raw = {};
+          return;
+        }
+      }
+      auto width = source == encoding::utf16_le || source == encoding::utf16_be ? std::size_t{ 2 } : std::size_t{ 4 };
+      auto big_endian = source == encoding::utf16_be || source == encoding::utf32_be;
+      auto complete = _ended ? raw.size() : raw.size() / width * width;
+      if (width == 2 && complete >= 2 && !_ended) {
+        auto last = static_cast<unsigned char>(raw[complete - (big_endian ? 2 : 1)]);
+        if (last >= 0xD8 && last <= 0xDB) complete -= 2;
+      }
+      if (!complete) return;
+
+      compact();
+      auto units = std::string_view{ raw }.substr(0, complete);
+      auto problem = std::string_view{};
+      auto at = std::size_t{ 0 };
+      auto size = buffer.size();
+      // the units are transcoded straight at the end of the buffer
+      auto capacity = width == 2 ? detail::utf8_capacity<2>(units) : detail::utf8_capacity<4>(units);
+      buffer.resize_and_overwrite(size + capacity, [&](char *_data, std::size_t) {
+        return size + (width == 2 ? detail::transcode<2>(units, big_endian, _data + size, problem, at)
+                                  : detail::transcode<4>(units, big_endian, _data + size, problem, at));
+      });
+      if (!problem.empty()) {
+        // located in the whole stream, the lines and columns in its utf-8 text
+        auto where = detail::locate(transcoded + at, std::string_view{ buffer }.substr(begin));
+        throw parse_error(problem, mark{ .index = where.index, .line = line + where.line, .column = where.column });
+      }
+      transcoded += complete;
+      raw.erase(0, complete);
+    }
+
+    void compact()
+    {
+      if (!begin || begin < buffer.size() / 2) return;
+      buffer.erase(0, begin);
+      offset += begin;
+      scanned -= begin;
+      searched -= std::min(searched, begin);
+      begin = 0;
+    }
+  };
+
+  // locates a mark of a document starting at _where in the whole stream
+  constexpr mark relocate(mark _at, mark _where) noexcept
+  {
+    return mark{ _at.index + _where.index, _at.line + _where.line, _at.column };
+  }
+
+  // loads a document split from a stream, it takes the ownership of its text when it views it. errors are located in
+  // the whole stream
+  template<typename Schema> auto load_document(const Schema &_schema, document_text _document)
+  {
+    try {
+      auto result = _schema.load(*_document.text);
+      if constexpr (requires { result.hold(std::move(_document.text)); }) result.hold(std::move(_document.text));
+      return result;
+    } catch (const parse_error &_error) {
+      throw parse_error(_error.problem(), relocate(_error.where(), _document.where));
+    }
+  }
+
+  // parses a document as its lines are received. the parser goes as far as the lines allow: once its next event
+  // depends on the lines still to come, it is restored to its state after the last event handed over and waits for
+  // them. the text grows into larger buffers and keeps the previous ones, so the tokens ahead and the scalars handed
+  // over keep viewing them until the document is done. events and errors are located in the whole stream
+  class document_events
+  {
+  public:
+    document_events() = default;
+    document_events(const document_events &) = delete;
+    document_events &operator=(const document_events &) = delete;
+
+    // starts the document at _where, its decoded scalars are stored in _resource
+    void start(mark _where, std::pmr::memory_resource &_resource)
+    {
+      where = _where;
+      pool = string_pool{ _resource };
+      // the buffers are recycled unless a document holds them
+      if (text.use_count() == 1 && !text->empty()) {
+        text->erase(text->begin(), std::prev(text->end()));
+        text->back().clear();
+      } else
+        text = std::make_shared<std::deque<std::string>>();
+      events.reset({});
+      open = true;
+      failed = false;
+    }
+
+    bool started_at(mark _where) const noexcept { return open && where.index == _where.index; }
+
+    // hands the events the lines of _text allow over to _visitor, _text starts with the lines received so far and
+    // ends the document when _complete. an exception fails the document, the rest of it is then skipped. true once
+    // the whole document has been handed over
+    template<typename Visitor> bool receive(std::string_view _text, bool _complete, Visitor &&_visitor)
+    {
+      auto known = view().size();
+      open = !_complete;
+      if (failed || (_text.size() == known && !_complete)) return false;
+      append(_text.substr(known));
+      events.extend(view(), !_complete);
+      try {
+        parse(_visitor, !_complete);
+      } catch (...) {
+        failed = true;
+        throw;
+      }
+      return _complete;
+    }
+
+    // the buffers of the text, for the document viewing them
+    std::shared_ptr<const void> content() const noexcept { return text; }
+
+  private:
+    mark where;
+    std::shared_ptr<std::deque<std::string>> text = std::make_shared<std::deque<std::string>>();
+    string_pool pool{ *std::pmr::get_default_resource() };
+    parser events{ {}, pool };
+    parser saved{ {}, pool };
+    bool open = false;
+    bool failed = false;
+
+    std::string_view view() const noexcept { return text->empty() ? std::string_view{} : text->back(); }
+
+    void append(std::string_view _lines)
+    {
+      auto size = view().size();
+      if (text->empty() || text->back().capacity() - size < _lines.size()) {
+        auto grown = std::string{};
+        grown.reserve(std::max(2 * size, size + _lines.size()));
+        grown.append(view());
+        text->push_back(std::move(grown));
+      }
+      text->back().append(_lines);
+    }
+
+    // a partial text is parsed from a copy of the parser, the events handed over before the lines ran out are parsed
+    // again from it, so that the parser is left after the last of them
+    void parse(auto &_visitor, bool _partial)
+    {
+      if (_partial) saved = events;
+      auto produced = std::size_t{ 0 };
+      while (!events.done()) {
+        auto event = yaml::event{};
+        try {
+          event = events.next();
+        } catch (const need_input &) {
+          events = saved;
+          for (; produced; --produced) events.next();
+          return;
+        } catch (const parse_error &_error) {
+          throw parse_error(_error.problem(), relocate(_error.where(), where));
+        }
+        ++produced;
+        event.start = relocate(event.start, where);
+        event.end = relocate(event.end, where);
+        _visitor(std::as_const(event));
+      }
+    }
+  };
+
+  // schemas loading trees through the composer, their documents are composed while their lines are received
+  template<typename Schema>
+  concept composing = !gathers_stats<Schema> && requires(const Schema &_schema, const event &_event) {
+    typename Schema::node;
+    _schema.make_scalar(_event);
+    _schema.max_alias_expansion;
+    requires std::same_as<decltype(_schema.load(std::string_view{})), document<typename Schema::node>>;
+  };
+
+  // composes a document from its events as they are parsed, the other schemas load the whole text of a document
+  template<typename Schema, bool = composing<Schema>> class composition
+  {};
+
+  template<typename Schema> class composition<Schema, true>
+  {
+  public:
+    using document_type = document<typename Schema::node>;
+
+    // starts a document, returns the resource of its scalars
+    std::pmr::memory_resource &start(const Schema &_schema)
+    {
+      builder.reset();
+      tree = document_type{};
+      builder.emplace(_schema, tree, _schema.max_alias_expansion);
+      root = nullptr;
+      return tree.resource();
+    }
+
+    void add(const event &_event)
+    {
+      switch (_event.type) {
+      case event_type::scalar:
+      case event_type::alias:
+      case event_type::sequence_start:
+      case event_type::sequence_end:
+      case event_type::mapping_start:
+      case event_type::mapping_end:
+        if (auto node = builder->add(_event)) root = node;
+        break;
+      default: break;
+      }
+    }
+
+    // the document holds _content its scalars view
+    document_type finish(const Schema &_schema, std::shared_ptr<const void> _content)
+    {
+      if (!root) root = tree.create(_schema.make_scalar(event{ .type = event_type::scalar, .implicit = true }));
+      tree.set_root(root);
+      tree.hold(std::move(_content));
+      builder.reset();
+      return std::move(tree);
+    }
+
+  private:
+    document_type tree;
+    std::optional<composer<Schema>> builder;
+    typename Schema::node *root = nullptr;
+  };
+
+}// namespace detail
+
+// reads a stream of documents one at a time: the input is split on the document markers starting a line and each
+// document is loaded on its own, so only the document being read is kept in memory. every document owns its content.
+// directives preceding a document marker belong to the following document. schemas producing values that own their
+// data, like bound<T>, do not keep the content. the encoding is detected from the first bytes of the stream like
+// detect_encoding does, utf-16 and utf-32 streams are transcoded to utf-8 chunk by chunk as they are read. their
+// errors are located in the utf-8 text, except for ill formed code units located at their byte in the stream.
+template<schematic Schema = failsafe> class stream
+{
+public:
+  using document_type = decltype(std::declval<const Schema &>().load(std::string_view{}));
+  // fills the span and returns the number of bytes read, 0 at the end of the stream
+  using reader = std::function<std::size_t(std::span<char>)>;
+
+  static constexpr std::size_t default_chunk_size = 64 * 1024;
+
+  class iterator
+  {
+  public:
+    using value_type = document_type;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    explicit iterator(stream &_stream) : source(&_stream) { ++*this; }
+
+    document_type &operator*() const { return *source->current; }
+    document_type *operator->() const { return &*source->current; }
+    iterator &operator++()
+    {
+      source->current = source->next();
+      return *this;
+    }
+    void operator++(int) { ++*this; }
+    bool operator==(std::default_sentinel_t) const noexcept { return !source || !source->current; }
+
+  private:
+    stream *source = nullptr;
+  };
+
+  explicit stream(reader _read, std::size_t _chunk_size = default_chunk_size, Schema _schema = {})
+    : read(std::move(_read)), chunk_size(std::max<std::size_t>(_chunk_size, 1)), schema(std::move(_schema))
+  {}
+
+  explicit stream(std::istream &_input, std::size_t _chunk_size = default_chunk_size, Schema _schema = {})
+    : stream(
+        [&_input](std::span<char> _chunk) {
+          _input.read(_chunk.data(), static_cast<std::streamsize>(_chunk.size()));
+          return static_cast<std::size_t>(_input.gcount());
+        },
+        _chunk_size, std::move(_schema))
+  {}
+
+  // reads a file descriptor without taking ownership of it, partial reads are consumed as soon as they arrive
+  explicit stream(int _descriptor, std::size_t _chunk_size = default_chunk_size, Schema _schema = {})
+    : stream(
+        [_descriptor](std::span<char> _chunk) -> std::size_t {
+          for (;;) {
+#ifdef _WIN32
+            auto count = ::_read(_descriptor, _chunk.data(), static_cast<unsigned>(_chunk.size()));
+#else
+            auto count = ::read(_descriptor, _chunk.data(), _chunk.size());
+#endif
+            if (count >= 0) return static_cast<std::size_t>(count);
+            if (errno != EINTR) throw std::system_error(errno, std::generic_category(), "cannot read the yaml stream");
+          }
+        },
+        _chunk_size, std::move(_schema))
+  {}
+
+  stream(const stream &) = delete;
+  stream &operator=(const stream &) = delete;
+
+  // loads the next document, nullopt once the stream is exhausted
+  std::optional<document_type> next()
+  {
+    for (;;) {
+      if (auto text = lines.next(exhausted)) return detail::load_document(schema, std::move(*text));
+      if (exhausted) return std::nullopt;
+      fill();
+    }
+  }
+
+  iterator begin() { return iterator{ *this }; }
+  std::default_sentinel_t end() const noexcept { return {}; }
+
+private:
+  reader read;
+  std::size_t chunk_size;
+  Schema schema;
+  std::optional<document_type> current;
+
+  detail::document_lines lines;
+  bool exhausted = false;
+
+  void fill()
+  {
+    auto count = read(lines.prepare(chunk_size));
+    lines.commit(count);
+    exhausted = count == 0;
+  }
+};
+
+// incremental parsing, the push counterpart of stream for input arriving from a socket or a pipe: feed() takes the
+// bytes as they are received and parses them right away. a chunk may end anywhere, even inside a token or a multi-byte
+// character: the incomplete line waits for the chunks completing it, the complete lines are parsed as far as they
+// allow and the parsing resumes from there with the next ones, so only the text of the current document is kept.
+// the events are handed to an event handler as soon as they are known, from stream_start to the stream_end of
+// finish(). a document handler gets every document once the next --- marker, a ... marker or finish() completes it:
+// tree building schemas such as failsafe or core compose it while its lines are received, the others load its whole
+// text then. an ill formed document throws from the feed() or finish() finding the error, located in the whole
+// stream: the rest of the document is skipped and the following documents can still be fed. utf-16 and utf-32 input
+// is transcoded as stream does.
+template<schematic Schema = failsafe> class feed_parser
+{
+public:
+  using document_type = decltype(std::declval<const Schema &>().load(std::string_view{}));
+  using handler = std::function<void(document_type)>;
+  // the event views are valid during the call
+  using event_handler = std::function<void(const event &)>;
+
+  explicit feed_parser(handler _on_document, Schema _schema = {})
+    : on_document(std::move(_on_document)), schema(std::move(_schema))
+  {}
+
+  explicit feed_parser(event_handler _on_event) : on_event(std::move(_on_event)) {}
+
+  feed_parser(const feed_parser &) = delete;
+  feed_parser &operator=(const feed_parser &) = delete;
+
+  // parses the lines the chunk completes
+  void feed(std::span<const char> _chunk)
+  {
+    lines.append(_chunk);
+    drain(false);
+  }
+
+  // ends the stream, its last document is handed over
+  void finish()
+  {
+    drain(true);
+    if (!on_event) return;
+    start_stream();
+    auto end = lines.end();
+    on_event(event{ .type = event_type::stream_end, .start = end, .end = end });
+  }
+
+private:
+  handler on_document;
+  event_handler on_event;
+  Schema schema;
+  detail::document_lines lines;
+  detail::document_events parsing;
+  detail::composition<Schema> composed;
+  // decoded scalars of the events of the current document
+  std::pmr::monotonic_buffer_resource arena;
+  bool streaming = false;
+
+  void drain(bool _ended)
+  {
+    while (auto document = lines.split(_ended)) receive(*document, true);
+    if (!_ended) receive(lines.open(), false);
+  }
+
+  void receive(detail::document_view _document, bool _complete)
+  {
+    if constexpr (!detail::composing<Schema>) {
+      if (!on_event) {
+        if (_complete)
+          on_document(detail::load_document(schema,
+            detail::document_text{ std::make_shared<std::string>(_document.text), _document.where }));
+        return;
+      }
+    }
+    if (!parsing.started_at(_document.where)) {
+      if (_document.text.empty()) return;
+      start(_document.where);
+    }
+    [[maybe_unused]] auto done = parsing.receive(_document.text, _complete, [this](const event &_event) {
+      if (on_event)
+        hand_over(_event);
+      else if constexpr (detail::composing<Schema>)
+        composed.add(_event);
+    });
+    if constexpr (detail::composing<Schema>)
+      if (done && !on_event) on_document(composed.finish(schema, parsing.content()));
+  }
+
+  void start(mark _where)
+  {
+    if constexpr (detail::composing<Schema>) {
+      if (!on_event) return parsing.start(_where, composed.start(schema));
+    }
+    arena.release();
+    parsing.start(_where, arena);
+  }
+
+  // the stream events of the documents are replaced by the ones of the whole stream
+  void hand_over(const event &_event)
+  {
+    if (_event.type == event_type::stream_start || _event.type == event_type::stream_end) return start_stream();
+    on_event(_event);
+  }
+
+  void start_stream()
+  {
+    if (!std::exchange(streaming, true)) on_event(event{ .type = event_type::stream_start });
+  }
+};
+
+}// namespace yaml
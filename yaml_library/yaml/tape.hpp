@@ -0,0 +1,313 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <yaml/detail/parser.hpp>
+#include <yaml/encoding.hpp>
+#include <yaml/error.hpp>
+#include <yaml/event.hpp>
+
+namespace yaml {
+
+enum class tape_kind : std::uint8_t { scalar, sequence, mapping, alias };
+
+// one node of the document in depth first order, children directly follow their collection
+// - scalar: offset/size locate the content in the input, or in the tape storage when decoded is set
+// - sequence / mapping: size is the number of entries (pairs for a mapping)
+// - alias: offset is the index of the anchored node
+// next is the index of the following sibling, skipping the whole subtree
+struct tape_entry
+{
+  tape_kind kind = tape_kind::scalar;
+  bool decoded = false;
+  std::uint32_t size = 0;
+  std::uint32_t offset = 0;
+  std::uint32_t next = 0;
+};
+
+static_assert(sizeof(tape_entry) == 16);
+
+class tape;
+
+// lightweight cursor on a tape entry, aliases are followed transparently
+class tape_view
+{
+public:
+  template<bool Pairs> class iterator
+  {
+  public:
+    using value_type = std::conditional_t<Pairs, std::pair<tape_view, tape_view>, tape_view>;
+    using difference_type = std::ptrdiff_t;
+
+    iterator() = default;
+    iterator(const tape *_tape, std::uint32_t _index) : source(_tape), index(_index) {}
+
+    value_type operator*() const;
+    iterator &operator++();
+    iterator operator++(int)
+    {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+    bool operator==(const iterator &) const = default;
+
+  private:
+    const tape *source = nullptr;
+    std::uint32_t index = 0;
+  };
+
+  template<bool Pairs> struct range
+  {
+    iterator<Pairs> first;
+    iterator<Pairs> last;
+    iterator<Pairs> begin() const { return first; }
+    iterator<Pairs> end() const { return last; }
+  };
+
+  tape_view(const tape &_tape, std::uint32_t _index);
+
+  tape_kind kind() const noexcept { return entry().kind; }
+  bool is_scalar() const noexcept { return kind() == tape_kind::scalar; }
+  bool is_sequence() const noexcept { return kind() == tape_kind::sequence; }
+  bool is_mapping() const noexcept { return kind() == tape_kind::mapping; }
+  std::uint32_t index() const noexcept { return position; }
+
+  std::string_view scalar() const;
+  std::size_t size() const noexcept { return is_scalar() ? 0 : entry().size; }
+
+  range<false> items() const;
+  range<true> pairs() const;
+
+  std::optional<tape_view> find(std::string_view _key) const;
+  tape_view operator[](std::string_view _key) const;
+  tape_view operator[](std::size_t _index) const;
+
+  bool operator==(const tape_view &) const = default;
+
+private:
+  const tape *source;
+  std::uint32_t position;
+
+  const tape_entry &entry() const noexcept;
+};
+
+// a document stored as a single contiguous array of entries, scalars view the loaded content (the caller keeps it
+// alive unless the tape holds it) or the tape's own storage
+class tape
+{
+public:
+  tape_view root() const { return tape_view{ *this, 0 }; }
+  std::span<const tape_entry> entries() const noexcept { return nodes; }
+
+  // makes the tape own the content its scalars view
+  void hold(std::shared_ptr<const void> _content) noexcept { content = std::move(_content); }
+
+  std::string_view text(const tape_entry &_entry) const noexcept
+  {
+    return (_entry.decoded ? std::string_view{ storage } : input).substr(_entry.offset, _entry.size);
+  }
+
+private:
+  friend struct tape_schema;
+
+  std::string_view input;
+  std::shared_ptr<const std::string> transcoded;// utf-8 text of utf-16 and utf-32 content, input views it
+  std::string storage;
+  std::vector<tape_entry> nodes;
+  std::shared_ptr<const void> content;
+};
+
+struct tape_schema
+{
+  // nodes a full traversal may visit through aliases, beyond it loading fails
+  std::size_t max_alias_expansion = default_alias_expansion;
+
+  // loads the single document of the stream, an empty stream is loaded as an empty scalar
+  tape load(std::string_view _content) const
+  {
+    auto result = tape{};
+    if (detect_encoding(_content) == encoding::utf8) {
+      if (!is_utf8(_content)) detail::invalid_utf8(_content);
+      result.input = _content;
+    } else {
+      result.transcoded = std::make_shared<const std::string>(to_utf8(_content));
+      result.input = *result.transcoded;
+    }
+    if (result.input.size() > std::numeric_limits<std::uint32_t>::max())
+      throw std::length_error("tape documents are limited to 4GiB");
+
+    auto resource = std::pmr::monotonic_buffer_resource{};
+    auto pool = detail::string_pool{ resource };
+    auto events = detail::parser{ result.input, pool };
+    events.next();
+    if (events.peek().type == event_type::stream_end) {
+      result.nodes.push_back(tape_entry{ .next = 1 });
+      return result;
+    }
+
+    events.next();
+    record(events, result);
+    events.next();
+    if (events.peek().type != event_type::stream_end)
+      throw parse_error("expected a single document in the stream", events.peek().start);
+    return result;
+  }
+
+private:
+  struct frame
+  {
+    std::uint32_t index;
+    std::string_view anchor;
+    std::size_t size;// nodes of the subtree with aliases expanded
+  };
+
+  struct anchored
+  {
+    std::uint32_t index;
+    std::size_t size;
+  };
+
+  static std::uint32_t index_of(const tape &_tape) { return static_cast<std::uint32_t>(_tape.nodes.size()); }
+
+  // appends the entries of one node, collections are patched with their size and next sibling once closed. like the
+  // tree composer, anchors are registered once their node is complete and alias expansion is bounded
+  void record(detail::parser &_events, tape &_tape) const
+  {
+    auto open = std::vector<frame>{};
+    auto anchors = std::unordered_map<std::string_view, anchored>{};
+    auto expanded = std::size_t{ 0 };
+    auto &nodes = _tape.nodes;
+    auto count_child = [&](std::size_t _size) {
+      if (open.empty()) return;
+      ++nodes[open.back().index].size;
+      open.back().size += _size;
+    };
+
+    do {
+      auto event = _events.next();
+      auto index = index_of(_tape);
+      switch (event.type) {
+      case event_type::scalar: {
+        auto entry = tape_entry{ .kind = tape_kind::scalar, .size = static_cast<std::uint32_t>(event.value.size()), .next = index + 1 };
+        auto viewed = event.value.data() >= _tape.input.data()
+                      && event.value.data() < _tape.input.data() + _tape.input.size();
+        if (viewed)
+          entry.offset = static_cast<std::uint32_t>(event.value.data() - _tape.input.data());
+        else if (!event.value.empty()) {
+          entry.decoded = true;
+          entry.offset = static_cast<std::uint32_t>(_tape.storage.size());
+          _tape.storage += event.value;
+        }
+        if (!event.anchor.empty()) anchors[event.anchor] = anchored{ index, 1 };
+        nodes.push_back(entry);
+        count_child(1);
+        break;
+      }
+      case event_type::alias: {
+        auto found = anchors.find(event.anchor);
+        if (found == anchors.end()) throw parse_error("found undefined alias", event.start);
+        expanded += found->second.size;
+        if (expanded > max_alias_expansion) throw parse_error("aliases expand beyond the configured limit", event.start);
+        nodes.push_back(tape_entry{ .kind = tape_kind::alias, .offset = found->second.index, .next = index + 1 });
+        count_child(found->second.size);
+        break;
+      }
+      case event_type::sequence_start:
+      case event_type::mapping_start:
+        count_child(0);
+        nodes.push_back(tape_entry{ .kind = event.type == event_type::mapping_start ? tape_kind::mapping : tape_kind::sequence });
+        open.push_back(frame{ index, event.anchor, 1 });
+        break;
+      case event_type::sequence_end:
+      case event_type::mapping_end: {
+        auto done = open.back();
+        open.pop_back();
+        auto &collection = nodes[done.index];
+        collection.next = index;
+        if (collection.kind == tape_kind::mapping) collection.size /= 2;
+        if (!done.anchor.empty()) anchors[done.anchor] = anchored{ done.index, done.size };
+        if (!open.empty()) open.back().size += done.size;
+        break;
+      }
+      default: throw parse_error("unexpected event while composing a node", event.start);
+      }
+    } while (!open.empty());
+  }
+};
+
+inline tape_view::tape_view(const tape &_tape, std::uint32_t _index) : source(&_tape), position(_index)
+{
+  if (entry().kind == tape_kind::alias) position = entry().offset;
+}
+
+inline const tape_entry &tape_view::entry() const noexcept { return source->entries()[position]; }
+
+inline std::string_view tape_view::scalar() const
+{
+  if (!is_scalar()) throw std::invalid_argument("tape node is not a scalar");
+  return source->text(entry());
+}
+
+inline tape_view::range<false> tape_view::items() const
+{
+  if (is_scalar()) return {};
+  return { { source, position + 1 }, { source, entry().next } };
+}
+
+inline tape_view::range<true> tape_view::pairs() const
+{
+  if (!is_mapping()) throw std::invalid_argument("tape node is not a mapping");
+  return { { source, position + 1 }, { source, entry().next } };
+}
+
+inline std::optional<tape_view> tape_view::find(std::string_view _key) const
+{
+  for (auto [key, value] : pairs())
+    if (key.is_scalar() && key.scalar() == _key) return value;
+  return std::nullopt;
+}
+
+inline tape_view tape_view::operator[](std::string_view _key) const
+{
+  if (auto found = find(_key)) return *found;
+  throw std::out_of_range("key not found in tape mapping");
+}
+
+inline tape_view tape_view::operator[](std::size_t _index) const
+{
+  if (!is_sequence() || _index >= size()) throw std::out_of_range("index out of tape sequence range");
+  auto it = items().begin();
+  for (; _index; --_index) ++it;
+  return *it;
+}
+
+template<bool Pairs> auto tape_view::iterator<Pairs>::operator*() const -> value_type
+{
+  if constexpr (Pairs)
+    return { tape_view{ *source, index }, tape_view{ *source, source->entries()[index].next } };
+  else
+    return tape_view{ *source, index };
+}
+
+template<bool Pairs> auto tape_view::iterator<Pairs>::operator++() -> iterator &
+{
+  index = source->entries()[index].next;
+  if constexpr (Pairs) index = source->entries()[index].next;
+  return *this;
+}
+
+}// namespace yaml
@@ -1,15 +1,41 @@
 #pragma once
 
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <fstream>
 #include <ios>
 #include <iterator>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <variant>
 #include <vector>
 
+#include <yaml/bind.hpp>
+#include <yaml/core.hpp>
+#include <yaml/detail/composer.hpp>
+#include <yaml/detail/file.hpp>
+#include <yaml/detail/parser.hpp>
+#include <yaml/document.hpp>
+#include <yaml/emitter.hpp>
+#include <yaml/encoding.hpp>
+#include <yaml/error.hpp>
+#include <yaml/event.hpp>
+#include <yaml/events.hpp>
+#include <yaml/ondemand.hpp>
+#include <yaml/stats.hpp>
+#include <yaml/tape.hpp>
+
 namespace yaml {
 
 template<typename T>
@@ -17,41 +43,170 @@ concept schematic = requires(T _schema, std::string_view _content) { _schema.loa
 
 struct node
 {
-  virtual ~node() = default;
   template<typename Type> decltype(auto) as(this auto &&_self) { return std::get<Type>(_self.data); }
-  template<typename Type> decltype(auto) try_as(this auto &&_self) { return std::get_if<Type>(_self.data); }
+  template<typename Type> decltype(auto) try_as(this auto &&_self) { return std::get_if<Type>(&_self.data); }
   template<typename Type> decltype(auto) is(this auto &&_self) { return std::holds_alternative<Type>(_self.data); }
 };
 
-using node_ref = std::shared_ptr<node>;
-
 struct failsafe
 {
-  using scalar = std::string;
-  using sequence = std::vector<node_ref>;
-  using mapping = std::vector<std::pair<node_ref, node_ref>>;
+  struct node;
+  using node_ref = node *;
+  // plain and single line scalars are views of the loaded content, the caller keeps it alive
+  using scalar = std::string_view;
+  using sequence = std::span<node_ref>;
+  using mapping = std::span<std::pair<node_ref, node_ref>>;
   using node_data = std::variant<scalar, sequence, mapping>;
 
   struct node : yaml::node
   {
     node() = default;
-    node(node_data &&_data) : data(_data) {}
+    node(node_data &&_data) : data(std::move(_data)) {}
     node_data data;
   };
 
-  decltype(auto) get_node(this auto &&_self, node_ref _node) { return *static_cast<node *>(_node.get()); }
+  // nodes a full traversal may visit through aliases, beyond it loading fails
+  std::size_t max_alias_expansion = default_alias_expansion;
+
+  decltype(auto) get_node(this auto &&_self, node_ref _node) { return *_node; }
+
+  node_data make_scalar(const event &_event) const { return scalar{ _event.value }; }
+
+  // loads the single document of the stream, an empty stream is loaded as an empty scalar
+  document<node> load(std::string_view _content) const
+  {
+    return detail::compose_single(*this, _content, max_alias_expansion);
+  }
+};
+
+// hashed lookup over the scalar keys of a mapping, meant for large mappings queried many times. the table uses open
+// addressing with linear probing, each slot holds the hash of a key and the position of its entry so probing rarely
+// touches the nodes. the mapping itself is left untouched and keeps the insertion order for iteration. with duplicate
+// keys the first entry wins, like a linear scan.
+class key_index
+{
+public:
+  key_index() = default;
+
+  explicit key_index(failsafe::mapping _mapping) : entries(_mapping)
+  {
+    if (_mapping.size() >= empty) throw std::length_error("mapping too large to be indexed");
+    auto capacity = std::bit_ceil(std::max<std::size_t>(_mapping.size() * 2, 8));
+    slots.assign(capacity, slot{ 0, empty });
+    mask = capacity - 1;
+    for (auto position = std::size_t{ 0 }; position < _mapping.size(); ++position) {
+      auto *key = _mapping[position].first->try_as<failsafe::scalar>();
+      if (!key) continue;
+      auto hash = std::hash<std::string_view>{}(*key);
+      auto index = hash & mask;
+      for (; slots[index].position != empty; index = (index + 1) & mask)
+        if (slots[index].hash == static_cast<std::uint32_t>(hash) && key_at(slots[index].position) == *key) break;
+      if (slots[index].position == empty)
+        slots[index] = slot{ static_cast<std::uint32_t>(hash), static_cast<std::uint32_t>(position) };
+    }
+  }
+
+  // value of the key, nullptr when the mapping has no such key
+  failsafe::node_ref find(std::string_view _key) const noexcept
+  {
+    if (slots.empty()) return nullptr;
+    auto hash = std::hash<std::string_view>{}(_key);
+    for (auto index = hash & mask; slots[index].position != empty; index = (index + 1) & mask)
+      if (slots[index].hash == static_cast<std::uint32_t>(hash) && key_at(slots[index].position) == _key)
+        return entries[slots[index].position].second;
+    return nullptr;
+  }
+
+  bool contains(std::string_view _key) const noexcept { return find(_key) != nullptr; }
+  failsafe::mapping mapping() const noexcept { return entries; }
+
+private:
+  static constexpr std::uint32_t empty = std::numeric_limits<std::uint32_t>::max();
+
+  struct slot
+  {
+    std::uint32_t hash;
+    std::uint32_t position;
+  };
+
+  failsafe::mapping entries;
+  std::vector<slot> slots;
+  std::size_t mask = 0;
 
-  node load(std::string_view)
+  std::string_view key_at(std::uint32_t _position) const noexcept
   {
-    return node{ mapping{ std::make_pair(std::make_shared<node>(scalar{ "values" }),
-      std::make_shared<node>(sequence{ std::make_shared<node>(scalar{ "one" }),
-        std::make_shared<node>(scalar{ "two" }),
-        std::make_shared<node>(scalar{ "three" }) })) } };
+    return entries[_position].first->as<failsafe::scalar>();
+  }
+};
+
+// loads through a tree building schema such as failsafe or core and fills a load_stats for every load. the clock is
+// read when the load goes from a phase to another and the allocations of the scanner, the parser and the composer are
+// counted along with the arena of the document, which slows the load down, the schema itself gathers nothing. the
+// scalars a lazy schema such as core converts when inspected are converted while loading, so that their construction
+// is measured
+template<typename Schema> struct instrumented : Schema
+{
+  static constexpr bool gathers_stats = true;
+
+  std::function<void(const load_stats &)> on_load;
+
+  typename Schema::node_data make_scalar(const event &_event) const
+  {
+    auto result = Schema::make_scalar(_event);
+    if constexpr (requires { typename Schema::pending; })
+      if (auto *scalar = std::get_if<typename Schema::pending>(&result)) result = Schema::convert(*scalar);
+    return result;
+  }
+
+  // hands the stats of the load to on_load
+  document<typename Schema::node> load(std::string_view _content) const
+  {
+    auto stats = load_stats{};
+    auto result = load(_content, stats);
+    if (on_load) on_load(stats);
+    return result;
+  }
+
+  document<typename Schema::node> load(std::string_view _content, load_stats &_stats) const
+  {
+    _stats = load_stats{ .bytes = _content.size() };
+    auto &upstream = detail::counting_resource::instance();
+    auto allocations = upstream.allocations;
+    auto bytes = upstream.allocated_bytes;
+    auto start = std::chrono::steady_clock::now();
+
+    auto result = document<typename Schema::node>{ upstream };
+    auto budget = this->max_alias_expansion;
+    result.set_root(detail::compose_document(*this, result, _content, budget, &_stats, &upstream));
+
+    _stats.total = std::chrono::steady_clock::now() - start;
+    _stats.alias_expansion = this->max_alias_expansion - budget;
+    _stats.allocations = upstream.allocations - allocations;
+    _stats.allocated_bytes = upstream.allocated_bytes - bytes;
+    return result;
   }
 };
 
 template<schematic Schema = failsafe> auto load(std::string_view _content) { return Schema{}.load(_content); }
 
+// loads as the instrumented schema would and fills _stats with the figures of the load
+template<schematic Schema = failsafe> auto load(std::string_view _content, load_stats &_stats)
+{
+  if constexpr (detail::gathers_stats<Schema>)
+    return Schema{}.load(_content, _stats);
+  else
+    return instrumented<Schema>{}.load(_content, _stats);
+}
+
+// loads a file without copying it when it can be mapped, the document keeps the content alive
+template<schematic Schema = failsafe> auto load_file(const std::filesystem::path &_path)
+{
+  auto content = std::make_shared<const detail::file_content>(_path);
+  auto result = Schema{}.load(content->view());
+  result.hold(std::move(content));
+  return result;
+}
+
 }// namespace yaml
 
 // ---